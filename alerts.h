@@ -0,0 +1,75 @@
+/* ================= ALERT SOCKET =================
+ * Pushes alert events to subscribers on a loopback TCP port, one JSON
+ * line per event, as the ingest worker raises them. Subscribers only
+ * listen; whatever they send is ignored.
+ *
+ * alertPublish() runs on the ingest path, so it never waits on a
+ * subscriber: sockets are non-blocking and one that cannot take a
+ * whole line (gone, or too slow to drain its buffer) is dropped. A
+ * dropped subscriber reconnects and asks the query socket (FLOOD) for
+ * the current state.
+ */
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include "platform.h"
+
+#define ALERT_PORT        8892
+#define ALERT_SUBSCRIBERS 16
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0                  // no SIGPIPE to suppress
+#endif
+
+static sock_t alertSubs[ALERT_SUBSCRIBERS];
+static int alertSubCount;
+static Mutex alertCs;
+static int alertOn;                     // set once the listener runs
+
+/* ---------- PUBLISH ---------- */
+static inline void alertPublish(const char *line, size_t len) {
+    if (!alertOn) return;
+    mutexLock(&alertCs);
+    for (int i = 0; i < alertSubCount; ) {
+        int n = send(alertSubs[i], line, (int)len, MSG_NOSIGNAL);
+        if (n == (int)len) { i++; continue; }
+
+        /* a partial line would corrupt the stream: drop the subscriber */
+        sockClose(alertSubs[i]);
+        alertSubs[i] = alertSubs[--alertSubCount];
+    }
+    mutexUnlock(&alertCs);
+}
+
+/* ---------- ACCEPT ---------- */
+static THREAD_FUNC(alertListen) {
+    sock_t ls = (sock_t)(intptr_t)arg;
+    while (1) {
+        sock_t s = accept(ls, NULL, NULL);
+        if (s == INVALID_SOCK) { sleepMs(100); continue; }
+
+#ifdef _WIN32
+        u_long nb = 1;
+        ioctlsocket(s, FIONBIO, &nb);
+#else
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+        mutexLock(&alertCs);
+        if (alertSubCount < ALERT_SUBSCRIBERS) alertSubs[alertSubCount++] = s;
+        else sockClose(s);
+        mutexUnlock(&alertCs);
+    }
+    THREAD_RETURN;
+}
+
+/* Returns 0 once the listener is running. */
+static inline int alertStart(unsigned short port) {
+    sock_t ls = tcpListen(port, 1);
+    if (ls == INVALID_SOCK) return -1;
+
+    mutexInit(&alertCs);
+    alertOn = 1;
+    return startThread(alertListen, (void*)(intptr_t)ls);
+}
+
+#endif
@@ -1,241 +1,314 @@
 const express = require("express");
 const fs = require("fs");
+const net = require("net");
+const path = require("path");
 const cors = require("cors");
+const { SegmentReader } = require("./segmentReader");
+const { LogFollower } = require("./logFollower");
+const { rollup } = require("./rollup");
 
 const app = express();
 app.use(cors());
 
-const LOG_FILE = "C:\\Users\\user\\Desktop\\Final_Year_Project\\Final_Year_Project\\server_log.txt";
-
-/* ---------- PARSE LOG FILE ---------- */
-function parseLogFile() {
-  if (!fs.existsSync(LOG_FILE)) {
-    return {
-      sensorData: [],
-      registrations: [],
-      errors: [],
-      nodeStatus: {}
-    };
+const LOG_FILE = process.env.LOG_FILE || "C:\\Users\\user\\Desktop\\Final_Year_Project\\Final_Year_Project\\server_log.txt";
+
+/* binary segment log the server writes next to the text log */
+const SEGMENT_DIR = process.env.SEGMENT_DIR || path.join(path.dirname(LOG_FILE), "segments");
+const segments = new SegmentReader(SEGMENT_DIR);
+
+/* UDP server's in-memory store (server.c --query-port) */
+const QUERY_HOST = process.env.QUERY_HOST || "127.0.0.1";
+const QUERY_PORT = Number(process.env.QUERY_PORT) || 8890;
+const QUERY_TIMEOUT_MS = 1000;
+
+/* flood alerts the server pushes as it ingests (server.c --alert-port) */
+const ALERT_PORT = Number(process.env.ALERT_PORT) || 8892;
+const ALERT_RETRY_MS = 2000;
+
+/* ---------- SERVER QUERY SOCKET ----------
+   One persistent connection; the server answers each command line
+   with one JSON line, in order, so replies are matched FIFO. */
+let querySock = null;
+let queryBuf = "";
+const queryPending = [];
+
+function failPending(err) {
+  while (queryPending.length) {
+    const p = queryPending.shift();
+    clearTimeout(p.timer);
+    p.reject(err);
   }
+}
 
-  const lines = fs.readFileSync(LOG_FILE, "utf8")
-    .trim()
-    .split("\n");
-
-  const sensorData = [];
-  const registrations = [];
-  const errors = [];
-  const nodeStatus = {};
-  let lastNode = null;
-
-  lines.forEach(line => {
-
-    /* ---------- NODE TRACK ---------- */
-    const nodeMatch = line.match(/Node(\d+)/);
-    if (nodeMatch) {
-      lastNode = Number(nodeMatch[1]);
-    }
-
-    /* ---------- REGISTER ---------- */
-    if (line.includes("REGISTER ->")) {
-      const regMatch = line.match(/\[(.*?)\] (?:Node(\d+) )?REGISTER -> (.*)/);
-      if (regMatch) {
-        const node = regMatch[2] ? Number(regMatch[2]) : lastNode;
-        if (node) {
-          registrations.push({
-            time: regMatch[1],
-            node,
-            message: regMatch[3],
-            type: regMatch[3].includes("Auto-registered") ? "auto" : "manual"
-          });
-        }
-      }
-    }
-
-    /* ---------- DATA (TEMP + HUM + SOIL + WATER) ---------- */
-    if (line.includes("DATA ->")) {
-      let dataMatch = line.match(
-        /\[(.*?)\] Node(\d+) DATA -> TEMP=([\d.]+) HUM=([\d.]+) SOIL=([\d.]+) WATER=([\d.]+)/ 
-      );
-
-      if (!dataMatch) {
-        dataMatch = line.match(
-          /\[(.*?)\] DATA -> TEMP=([\d.]+) HUM=([\d.]+) SOIL=([\d.]+) WATER=([\d.]+)/
-        );
-
-        if (dataMatch && lastNode) {
-          sensorData.push({
-            time: dataMatch[1],
-            node: lastNode,
-            temperature: Number(dataMatch[2]),
-            humidity: Number(dataMatch[3]),
-            soil: Number(dataMatch[4]),
-            water: Number(dataMatch[5])
-          });
-
-          nodeStatus[lastNode] = { status: "online", lastEvent: "DATA" };
-        }
-
-      } else {
-        const node = Number(dataMatch[2]);
-
-        sensorData.push({
-          time: dataMatch[1],
-          node,
-          temperature: Number(dataMatch[3]),
-          humidity: Number(dataMatch[4]),
-          soil: Number(dataMatch[5]),
-          water: Number(dataMatch[6])
-        });
-
-        nodeStatus[node] = { status: "online", lastEvent: "DATA" };
+function connectQuery() {
+  querySock = net.createConnection(QUERY_PORT, QUERY_HOST);
+  querySock.setNoDelay(true);
+  querySock.setEncoding("utf8");
+
+  querySock.on("data", chunk => {
+    queryBuf += chunk;
+    let nl;
+    while ((nl = queryBuf.indexOf("\n")) !== -1) {
+      const line = queryBuf.slice(0, nl);
+      queryBuf = queryBuf.slice(nl + 1);
+      const p = queryPending.shift();
+      if (!p) continue;
+      clearTimeout(p.timer);
+      try {
+        const reply = JSON.parse(line);
+        reply && reply.error ? p.reject(new Error(reply.error)) : p.resolve(reply);
+      } catch (err) {
+        p.reject(err);
       }
     }
+  });
 
-    /* ---------- RECONNECT ---------- */
-    if (line.includes("RECONNECT ->") && lastNode) {
-      nodeStatus[lastNode] = { status: "online", lastEvent: "RECONNECT" };
-    }
-
-    /* ---------- DISCONNECT ---------- */
-    if (line.includes("DISCONNECT ->") && lastNode) {
-      nodeStatus[lastNode] = { status: "offline", lastEvent: "DISCONNECT" };
-    }
+  const sock = querySock;
+  const reset = err => {
+    sock.destroy();
+    if (querySock !== sock) return;
+    querySock = null;
+    queryBuf = "";
+    failPending(err || new Error("query socket closed"));
+  };
+  sock.on("error", reset);
+  sock.on("close", () => reset());
+}
 
-    /* ---------- UNKNOWN ---------- */
-    if (line.includes("UNKNOWN ->")) {
-      const errMatch = line.match(/\[(.*?)\] Node(\d+) UNKNOWN -> (.*)/);
-      if (errMatch) {
-        errors.push({
-          time: errMatch[1],
-          node: Number(errMatch[2]),
-          message: errMatch[3]
-        });
-      }
-    }
+function queryServer(command) {
+  return new Promise((resolve, reject) => {
+    if (!querySock) connectQuery();
+    const p = { resolve, reject, timer: null };
+    p.timer = setTimeout(() => {
+      /* replies are FIFO, so a lost one poisons the stream */
+      if (querySock) querySock.destroy();
+      reject(new Error("query timeout"));
+    }, QUERY_TIMEOUT_MS);
+    queryPending.push(p);
+    querySock.write(command + "\n");
   });
+}
 
-  return { sensorData, registrations, errors, nodeStatus };
+/* Ask the server first; fall back to parsing the log when it is not
+   running or was started without the query socket. */
+async function fromServer(command, fallback) {
+  try {
+    return await queryServer(command);
+  } catch (err) {
+    if (err.message === "Node not found") throw err;
+    return fallback();
+  }
 }
 
+/* ---------- TEXT LOG ----------
+   Followed incrementally: each call only parses lines appended since
+   the previous one, across the server's rotated files as well as the
+   active one (logFollower.js). */
+const logTail = new LogFollower(LOG_FILE);
+logTail.sync();
+logTail.watch();
+
 /* ---------- GET LATEST SENSOR DATA ---------- */
 function getLatestSensorData(limit = 50) {
-  const { sensorData } = parseLogFile();
-  // 🔥 FIXED: remove reverse to preserve proper order
-  return sensorData.slice(-limit);
+  if (segments.available()) return segments.latest(limit);
+  return logTail.latest(limit);
 }
 
 /* ---------- GET NODE STATISTICS ---------- */
 function getNodeStats() {
-  const { sensorData, registrations, nodeStatus } = parseLogFile();
-  const nodeMap = {};
-
-  sensorData.forEach(d => {
-    if (!nodeMap[d.node]) {
-      nodeMap[d.node] = {
-        id: d.node,
-        totalReadings: 0,
-        lastSeen: null,
-        firstSeen: null,
-        avgTemp: 0,
-        avgHum: 0,
-        avgSoil: 0,
-        avgWater: 0,
-        minTemp: Infinity,
-        maxTemp: -Infinity,
-        minHum: Infinity,
-        maxHum: -Infinity,
-        minSoil: Infinity,
-        maxSoil: -Infinity,
-        minWater: Infinity,
-        maxWater: -Infinity,
-        registrations: 0
-      };
-    }
-
-    const node = nodeMap[d.node];
-    node.totalReadings++;
-    node.lastSeen = d.time;
-    if (!node.firstSeen) node.firstSeen = d.time;
-
-    node.avgTemp = ((node.avgTemp * (node.totalReadings - 1)) + d.temperature) / node.totalReadings;
-    node.avgHum = ((node.avgHum * (node.totalReadings - 1)) + d.humidity) / node.totalReadings;
-    node.avgSoil = ((node.avgSoil * (node.totalReadings - 1)) + d.soil) / node.totalReadings;
-    node.avgWater = ((node.avgWater * (node.totalReadings - 1)) + d.water) / node.totalReadings;
-
-    node.minTemp = Math.min(node.minTemp, d.temperature);
-    node.maxTemp = Math.max(node.maxTemp, d.temperature);
-    node.minHum = Math.min(node.minHum, d.humidity);
-    node.maxHum = Math.max(node.maxHum, d.humidity);
-    node.minSoil = Math.min(node.minSoil, d.soil);
-    node.maxSoil = Math.max(node.maxSoil, d.soil);
-    node.minWater = Math.min(node.minWater, d.water);
-    node.maxWater = Math.max(node.maxWater, d.water);
-  });
-
-  registrations.forEach(r => {
-    if (nodeMap[r.node]) nodeMap[r.node].registrations++;
-  });
-
-  Object.values(nodeMap).forEach(node => {
-    node.avgTemp = Number(node.avgTemp.toFixed(2));
-    node.avgHum = Number(node.avgHum.toFixed(2));
-    node.avgSoil = Number(node.avgSoil.toFixed(2));
-    node.avgWater = Number(node.avgWater.toFixed(2));
-
-    node.status = nodeStatus[node.id]?.status || "offline";
-    node.lastEvent = nodeStatus[node.id]?.lastEvent || "UNKNOWN";
-  });
+  if (segments.available()) return segments.nodeStats();
+  return logTail.nodeStats();
+}
 
-  return Object.values(nodeMap);
+/* ---------- GET NODE ROLLUP ----------
+   Chart buckets for one node over [fromMs, toMs]; the server keeps
+   these pre-aggregated, this is the fallback without it. */
+function getNodeRollup(nodeId, fromMs, toMs, points) {
+  const each = segments.available()
+    ? visit => segments.range(nodeId, fromMs, toMs, visit)
+    : visit => logTail.latest(Infinity).forEach(r => r.node === nodeId && visit(r));
+  return rollup(nodeId, each, fromMs, toMs, points);
 }
 
 /* ---------- GET REGISTRATION HISTORY ---------- */
 function getRegistrationHistory(limit = 20) {
-  const { registrations } = parseLogFile();
-  return registrations.slice(-limit).reverse();
+  return logTail.latestRegistrations(limit);
 }
 
 /* ---------- GET ERROR LOG ---------- */
 function getErrorLog(limit = 20) {
-  const { errors } = parseLogFile();
-  return errors.slice(-limit).reverse();
+  return logTail.latestErrors(limit);
 }
 
 /* ---------- GET SYSTEM OVERVIEW ---------- */
 function getSystemOverview() {
-  const { sensorData, registrations, errors } = parseLogFile();
-  const nodes = getNodeStats();
-
-  return {
-    totalNodes: nodes.length,
-    totalReadings: sensorData.length,
-    totalRegistrations: registrations.length,
-    totalErrors: errors.length,
-    activeNodes: nodes.filter(n => n.status === "online").length,
-    avgTemperature: nodes.length > 0
-      ? (nodes.reduce((sum, n) => sum + n.avgTemp, 0) / nodes.length).toFixed(2)
-      : 0,
-    avgHumidity: nodes.length > 0
-      ? (nodes.reduce((sum, n) => sum + n.avgHum, 0) / nodes.length).toFixed(2)
-      : 0
-  };
+  if (segments.available()) return segments.overview();
+  return logTail.overview();
+}
+
+/* ---------- LIVE STREAM (SSE) ----------
+   /api/stream sends a snapshot, then deltas as the server appends to
+   its log: new readings and nodes whose status changed. Deltas are
+   coalesced for STREAM_FLUSH_MS so a burst of readings costs one
+   message per client, capped at STREAM_MAX_READINGS rows. */
+const STREAM_FLUSH_MS = 200;
+const STREAM_MAX_READINGS = 50;
+const STREAM_KEEPALIVE_MS = 15000;
+
+const streamClients = new Set();
+let streamReadings = [];
+let streamNodes = new Map();
+let streamTimer = null;
+
+function sendEvent(res, event, data) {
+  res.write(`event: ${event}\ndata: ${JSON.stringify(data)}\n\n`);
+}
+
+function flushStream() {
+  streamTimer = null;
+  const delta = { readings: streamReadings, nodes: [...streamNodes.values()] };
+  streamReadings = [];
+  streamNodes = new Map();
+  for (const res of streamClients) sendEvent(res, "delta", delta);
+}
+
+function queueStream() {
+  if (!streamTimer && streamClients.size)
+    streamTimer = setTimeout(flushStream, STREAM_FLUSH_MS);
+}
+
+logTail.on("reading", r => {
+  if (!streamClients.size) return;
+  streamReadings.push(r);
+  if (streamReadings.length > STREAM_MAX_READINGS)
+    streamReadings.splice(0, streamReadings.length - STREAM_MAX_READINGS);
+  queueStream();
+});
+
+logTail.on("node", n => {
+  if (!streamClients.size) return;
+  streamNodes.set(n.id, n);
+  queueStream();
+});
+
+setInterval(() => {
+  for (const res of streamClients) res.write(": keepalive\n\n");
+}, STREAM_KEEPALIVE_MS).unref();
+
+/* ---------- FLOOD ALERTS ----------
+   Every event from the server's alert socket goes straight out to the
+   stream clients, not batched with readings. While the server is down
+   the connection is retried; the FLOOD state in each snapshot covers
+   whatever was missed. */
+function subscribeAlerts() {
+  const sock = net.createConnection(ALERT_PORT, QUERY_HOST);
+  let buf = "";
+  sock.setEncoding("utf8");
+
+  sock.on("data", chunk => {
+    buf += chunk;
+    let nl;
+    while ((nl = buf.indexOf("\n")) !== -1) {
+      const line = buf.slice(0, nl);
+      buf = buf.slice(nl + 1);
+      try {
+        const alert = JSON.parse(line);
+        for (const res of streamClients) sendEvent(res, "alert", alert);
+      } catch (err) {
+        console.error("Bad alert line:", line);
+      }
+    }
+  });
+  sock.on("error", () => {});
+  sock.on("close", () => setTimeout(subscribeAlerts, ALERT_RETRY_MS).unref());
 }
+subscribeAlerts();
 
 /* ---------- API ENDPOINTS ---------- */
-app.get("/api/sensor-data", (req, res) => {
+app.get("/api/sensor-data", async (req, res) => {
   const limit = parseInt(req.query.limit) || 50;
-  res.json(getLatestSensorData(limit));
+  res.json(await fromServer(`LATEST ${limit}`, () => getLatestSensorData(limit)));
 });
 
-app.get("/api/nodes", (req, res) => {
-  res.json(getNodeStats());
+app.get("/api/nodes", async (req, res) => {
+  res.json(await fromServer("NODES", getNodeStats));
 });
 
-app.get("/api/nodes/:id", (req, res) => {
+app.get("/api/nodes/:id", async (req, res) => {
   const nodeId = parseInt(req.params.id);
-  const node = getNodeStats().find(n => n.id === nodeId);
-  node ? res.json(node) : res.status(404).json({ error: "Node not found" });
+  try {
+    const node = await fromServer(`NODE ${nodeId}`,
+      () => getNodeStats().find(n => n.id === nodeId));
+    node ? res.json(node) : res.status(404).json({ error: "Node not found" });
+  } catch (err) {
+    res.status(404).json({ error: "Node not found" });
+  }
+});
+
+app.get("/api/nodes/:id/rollup", async (req, res) => {
+  const nodeId = parseInt(req.params.id);
+  const hours = Math.max(Number(req.query.hours) || 24, 0.1);
+  const points = Math.min(Math.max(parseInt(req.query.points) || 500, 1), 10000);
+  const to = Math.floor(Date.now() / 1000);
+  const from = Math.floor(to - hours * 3600);
+
+  res.json(await fromServer(`ROLLUP ${nodeId} ${from} ${to} ${points}`,
+    () => getNodeRollup(nodeId, from * 1000, to * 1000 + 999, points)));
+});
+
+/* Sequence-number loss / reorder / duplicate counters per node. Only
+   the running server has them. */
+app.get("/api/loss", async (req, res) => {
+  const loss = await fromServer("LOSS", () => null);
+  loss ? res.json(loss) : res.status(503).json({ error: "Server not reachable" });
+});
+
+/* Send policy changes, pushed to the nodes over the downlink. The
+   body is the keys to change, e.g. {"water-rate": 4, "max-silence-ms":
+   60000}; see sendpolicy.h. "all" targets every node. */
+app.post("/api/nodes/:id/policy", express.json(), async (req, res) => {
+  const target = req.params.id === "all" ? "*" : parseInt(req.params.id);
+  const pairs = Object.entries(req.body || {});
+  if (!target || !pairs.length ||
+      pairs.some(([k, v]) => !/^[A-Za-z.-]+$/.test(k) || !Number.isFinite(v)))
+    return res.status(400).json({ error: "Expected {\"<sensor>-<delta|deadband|rate>\": number, ...}" });
+
+  try {
+    res.json(await queryServer(`POLICY ${target} ` + pairs.map(([k, v]) => `${k}=${v}`).join(" ")));
+  } catch (err) {
+    if (err.message === "Node not found") return res.status(404).json({ error: err.message });
+    if (err.message.startsWith("usage")) return res.status(400).json({ error: err.message });
+    res.status(503).json({ error: "Server not reachable" });
+  }
+});
+
+/* Flood level, risk index and water rate per node, as the server
+   evaluates them on ingest. Only the running server has them. */
+app.get("/api/flood", async (req, res) => {
+  const flood = await fromServer("FLOOD", () => null);
+  flood ? res.json(flood) : res.status(503).json({ error: "Server not reachable" });
+});
+
+app.get("/api/stream", async (req, res) => {
+  const limit = parseInt(req.query.limit) || STREAM_MAX_READINGS;
+
+  res.writeHead(200, {
+    "Content-Type": "text/event-stream",
+    "Cache-Control": "no-cache",
+    Connection: "keep-alive"
+  });
+
+  /* catch up first so the snapshot and the first delta do not overlap */
+  logTail.sync();
+  const [sensorData, nodes, flood] = await Promise.all([
+    fromServer(`LATEST ${limit}`, () => getLatestSensorData(limit)),
+    fromServer("NODES", getNodeStats),
+    fromServer("FLOOD", () => null)
+  ]);
+  sendEvent(res, "snapshot", { sensorData, nodes, flood });
+
+  streamClients.add(res);
+  req.on("close", () => streamClients.delete(res));
 });
 
 app.get("/api/registrations", (req, res) => {
@@ -246,15 +319,16 @@ app.get("/api/errors", (req, res) => {
   res.json(getErrorLog());
 });
 
-app.get("/api/overview", (req, res) => {
-  res.json(getSystemOverview());
+app.get("/api/overview", async (req, res) => {
+  res.json(await fromServer("OVERVIEW", getSystemOverview));
 });
 
 app.get("/api/health", (req, res) => {
   res.json({
     status: "ok",
     timestamp: new Date().toISOString(),
-    logFile: fs.existsSync(LOG_FILE) ? "found" : "missing"
+    logFile: fs.existsSync(LOG_FILE) ? "found" : "missing",
+    segments: segments.available() ? "found" : "missing"
   });
 });
 
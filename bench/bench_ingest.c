@@ -0,0 +1,177 @@
+/* ================= INGEST BENCHMARK =================
+ * Measures how many datagrams per second one receiver can pull off
+ * a UDP socket, comparing the old loop (one blocking recvfrom per
+ * packet) against the platform layer (epoll + recvmmsg batches).
+ *
+ * With more than one worker each receiver gets its own SO_REUSEPORT
+ * socket, the same layout server.c uses with --workers, so running
+ * with 1, 2, 4 ... workers shows how ingestion scales with cores.
+ * Every packet is parsed like the server's DATA branch.
+ *
+ * Build: gcc -O2 bench/bench_ingest.c -o bench_ingest -lpthread
+ * Usage: ./bench_ingest [single|batch] [seconds] [senders] [workers]
+ */
+#include "../platform.h"
+#include <stdatomic.h>
+
+#define BENCH_PORT 18888
+#define PAYLOAD "DATA:TEMP=24.40 HUM=61.00 SOIL=71 WATER=42"
+
+static atomic_int sendersRunning;
+static atomic_int receiversRunning;
+static atomic_long packetsSent;
+static atomic_long packetsReceived;
+static atomic_long syscallsMade;
+static int benchSeconds = 5;
+static int batched = 1;
+
+/* ---------- PER-PACKET WORK ---------- */
+static int parsePacket(const char *buffer) {
+    float temp, hum;
+    int soil, water;
+    return sscanf(buffer, "DATA:TEMP=%f HUM=%f SOIL=%d WATER=%d",
+                  &temp, &hum, &soil, &water) == 4;
+}
+
+/* ---------- SENDER ---------- */
+THREAD_FUNC(sender) {
+    (void)arg;
+    PacketBatch *out = malloc(sizeof(PacketBatch));
+    sock_t s = udpOpen(0, 0);
+
+    batchInit(out);
+    for (int i = 0; i < RECV_BATCH; i++) {
+        out->len[i] = (int)strlen(PAYLOAD);
+        memcpy(out->buf[i], PAYLOAD, out->len[i]);
+        out->addr[i].sin_family = AF_INET;
+        out->addr[i].sin_port = htons(BENCH_PORT);
+        out->addr[i].sin_addr.s_addr = inet_addr("127.0.0.1");
+    }
+
+    uint64_t end = nowMs() + (uint64_t)benchSeconds * 1000;
+    long sent = 0;
+    while (nowMs() < end)
+        sent += udpSendBatch(s, out, RECV_BATCH);
+
+    atomic_fetch_add(&packetsSent, sent);
+    atomic_fetch_sub(&sendersRunning, 1);
+    sockClose(s);
+    free(out);
+    THREAD_RETURN;
+}
+
+/* ---------- RECEIVE: ONE SYSCALL PER PACKET ---------- */
+static long recvSingle(sock_t s, long *syscalls) {
+    char buffer[MAX_DATAGRAM];
+    struct sockaddr_in from;
+    long got = 0;
+
+    struct timeval tv = { 0, 200 * 1000 };
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+
+    while (1) {
+        socklen_t addrLen = sizeof(from);
+        int bytes = recvfrom(s, buffer, sizeof(buffer) - 1, 0,
+                             (struct sockaddr*)&from, &addrLen);
+        (*syscalls)++;
+        if (bytes > 0) {
+            buffer[bytes] = '\0';
+            got += parsePacket(buffer);
+            continue;
+        }
+        if (atomic_load(&sendersRunning) == 0) break;
+    }
+    return got;
+}
+
+/* ---------- RECEIVE: EPOLL + RECVMMSG ---------- */
+static long recvBatch(sock_t s, long *syscalls) {
+    PacketBatch *batch = malloc(sizeof(PacketBatch));
+    Poller poller;
+    long got = 0;
+
+    batchInit(batch);
+    pollerInit(&poller);
+    pollerAdd(&poller, s, 0);
+
+    while (1) {
+        int ready;
+        (*syscalls)++;
+        if (pollerWait(&poller, &ready, 1, 200) <= 0) {
+            if (atomic_load(&sendersRunning) == 0) break;
+            continue;
+        }
+
+        while (((*syscalls)++, udpRecvBatch(s, batch)) > 0)
+            for (int i = 0; i < batch->count; i++)
+                got += parsePacket(batch->buf[i]);
+    }
+
+    pollerClose(&poller);
+    free(batch);
+    return got;
+}
+
+/* ---------- RECEIVER THREAD ---------- */
+THREAD_FUNC(receiver) {
+    sock_t s = *(sock_t*)arg;
+    long syscalls = 0;
+    long got = batched ? recvBatch(s, &syscalls) : recvSingle(s, &syscalls);
+
+    atomic_fetch_add(&packetsReceived, got);
+    atomic_fetch_add(&syscallsMade, syscalls);
+    atomic_fetch_sub(&receiversRunning, 1);
+    THREAD_RETURN;
+}
+
+/* ================= MAIN ================= */
+int main(int argc, char **argv) {
+    const char *mode = argc > 1 ? argv[1] : "batch";
+    int senders = argc > 3 ? atoi(argv[3]) : 2;
+    int workers = argc > 4 ? atoi(argv[4]) : 1;
+    if (argc > 2) benchSeconds = atoi(argv[2]);
+    if (workers < 1) workers = 1;
+    if (senders < workers) senders = workers;
+
+    netInit();
+    batched = strcmp(mode, "single") != 0;
+
+    sock_t *socks = calloc(workers, sizeof(sock_t));
+    for (int k = 0; k < workers; k++) {
+        socks[k] = udpOpen(BENCH_PORT,
+                           (batched ? NET_NONBLOCK : 0) |
+                           (workers > 1 ? NET_REUSEPORT : 0));
+        if (socks[k] == INVALID_SOCK) {
+            printf("❌ Cannot bind port %d\n", BENCH_PORT);
+            return 1;
+        }
+    }
+
+    atomic_store(&sendersRunning, senders);
+    atomic_store(&receiversRunning, workers);
+
+    uint64_t start = nowMs();
+    for (int k = 0; k < workers; k++)
+        startThread(receiver, &socks[k]);
+    for (int i = 0; i < senders; i++)
+        startThread(sender, NULL);
+
+    while (atomic_load(&receiversRunning) > 0)
+        sleepMs(10);
+    double secs = (double)(nowMs() - start) / 1000.0;
+
+    long sent = atomic_load(&packetsSent);
+    long got = atomic_load(&packetsReceived);
+    long syscalls = atomic_load(&syscallsMade);
+    printf("mode=%s workers=%d senders=%d sent=%ld received=%ld pps=%.0f "
+           "syscalls/pkt=%.3f loss=%.1f%%\n",
+           batched ? "batch" : "single", workers, senders, sent, got,
+           got / secs, got ? (double)syscalls / got : 0.0,
+           sent ? 100.0 * (sent - got) / sent : 0.0);
+
+    for (int k = 0; k < workers; k++)
+        sockClose(socks[k]);
+    free(socks);
+    netCleanup();
+    return 0;
+}
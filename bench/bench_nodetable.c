@@ -0,0 +1,160 @@
+/* ================= NODE TABLE CONTENTION BENCHMARK =================
+ * N reader threads look nodes up by address and stamp lastSeen, the
+ * heartbeat path, while one writer keeps registering new nodes
+ * (so the table grows and index tables are retired) and moving
+ * nodes to new ports:
+ *   locked     every lookup takes the table lock, as when one
+ *              CRITICAL_SECTION guarded the whole client table
+ *   lock-free  registry.h readers; a miss is retried under the lock
+ * Reports heartbeats per second over all readers and how many
+ * lookups had to fall back to the lock.
+ *
+ * Build: gcc -O2 bench/bench_nodetable.c -o bench_nodetable -lpthread
+ *        (add -fsanitize=thread -g to check it under ThreadSanitizer)
+ * Usage: ./bench_nodetable [threads (8)] [ms per mode (1000)]
+ */
+#include "../platform.h"
+#include "../registry.h"
+
+#define START_NODES 1000
+#define MAX_THREADS 64
+#define WRITE_GAP_US 50
+
+static Registry reg;
+static Mutex lock;
+static struct sockaddr_in addrs[START_NODES];
+static atomic_int running;
+static atomic_int lockFree;
+
+typedef struct {
+    uint32_t rng;
+    uint64_t ops;
+    uint64_t fallbacks;
+    uint64_t misses;
+} Reader;
+
+static uint32_t rngNext(uint32_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static struct sockaddr_in makeAddr(uint32_t host, uint16_t port) {
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(host);
+    a.sin_port = htons(port);
+    return a;
+}
+
+/* ---------- READERS ---------- */
+static THREAD_FUNC(readerLoop) {
+    Reader *rd = (Reader*)arg;
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        const struct sockaddr_in *a = &addrs[rngNext(&rd->rng) % START_NODES];
+        int idx;
+        if (atomic_load_explicit(&lockFree, memory_order_relaxed)) {
+            idx = registryFindAddr(&reg, a);
+            if (idx == -1) {
+                rd->fallbacks++;
+                mutexLock(&lock);
+                idx = registryFindAddr(&reg, a);
+                mutexUnlock(&lock);
+            }
+            if (idx != -1) atomic_store(&registryAt(&reg, idx)->lastSeen, nowMs());
+        } else {
+            mutexLock(&lock);
+            idx = registryFindAddr(&reg, a);
+            if (idx != -1) atomic_store(&registryAt(&reg, idx)->lastSeen, nowMs());
+            mutexUnlock(&lock);
+        }
+        if (idx == -1) rd->misses++;
+        rd->ops++;
+    }
+    THREAD_RETURN;
+}
+
+/* ---------- WRITER ----------
+ * Adds nodes and moves added ones to new ports; the START_NODES the
+ * readers probe are never touched, so every lookup should hit.
+ */
+static int writerAdded;
+
+static THREAD_FUNC(writerLoop) {
+    (void)arg;
+    uint32_t rng = 99;
+    while (atomic_load(&running)) {
+        mutexLock(&lock);
+        int n = writerAdded++;
+        struct sockaddr_in a = makeAddr(0x0b000000u + (uint32_t)n, 2000);
+        registryAdd(&reg, &a, START_NODES + 1 + n);
+
+        int victim = START_NODES + (int)(rngNext(&rng) % (uint32_t)writerAdded);
+        a = makeAddr(0x0b000000u + (uint32_t)(victim - START_NODES),
+                     (uint16_t)(3000 + rngNext(&rng) % 30000));
+        registrySetAddr(&reg, victim, &a);
+        mutexUnlock(&lock);
+
+        struct timespec ts = { 0, WRITE_GAP_US * 1000 };
+        nanosleep(&ts, NULL);
+    }
+    THREAD_RETURN;
+}
+
+static void runMode(const char *name, int useLockFree, int threads, int ms) {
+    registryInit(&reg);
+    writerAdded = 0;
+    for (int i = 0; i < START_NODES; i++) {
+        addrs[i] = makeAddr(0x0a000000u + (uint32_t)i, (uint16_t)(1024 + i));
+        registryAdd(&reg, &addrs[i], i + 1);
+    }
+
+    static Reader readers[MAX_THREADS];
+    memset(readers, 0, sizeof(readers));
+    atomic_store(&lockFree, useLockFree);
+    atomic_store(&running, 1);
+
+    pthread_t tid[MAX_THREADS + 1];
+    for (int i = 0; i < threads; i++) {
+        readers[i].rng = 12345u + (uint32_t)i * 7919u;
+        pthread_create(&tid[i], NULL, readerLoop, &readers[i]);
+    }
+    pthread_create(&tid[threads], NULL, writerLoop, NULL);
+
+    uint64_t t0 = nowMs();
+    sleepMs(ms);
+    atomic_store(&running, 0);
+    for (int i = 0; i <= threads; i++)
+        pthread_join(tid[i], NULL);
+    double sec = (double)(nowMs() - t0) / 1000.0;
+
+    uint64_t ops = 0, fallbacks = 0, misses = 0;
+    for (int i = 0; i < threads; i++) {
+        ops += readers[i].ops;
+        fallbacks += readers[i].fallbacks;
+        misses += readers[i].misses;
+    }
+    printf("%-9s threads=%-2d %8.2f M heartbeats/s  fallbacks=%-6llu misses=%llu"
+           "  (writer: %d adds, table %d)\n",
+           name, threads, (double)ops / sec / 1e6,
+           (unsigned long long)fallbacks, (unsigned long long)misses,
+           writerAdded, registryCount(&reg));
+
+    epochReclaim();
+    registryFree(&reg);
+}
+
+/* ================= MAIN ================= */
+int main(int argc, char **argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 8;
+    int ms = argc > 2 ? atoi(argv[2]) : 1000;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    mutexInit(&lock);
+    runMode("locked", 0, threads, ms);
+    runMode("lock-free", 1, threads, ms);
+    return 0;
+}
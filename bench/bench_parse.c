@@ -0,0 +1,131 @@
+/* ================= PARSER BENCHMARK =================
+ * Cost per line of the v1 DATA payload and the Arduino serial line,
+ * parsed with kvparse.h next to the sscanf calls it replaced. Also
+ * checks kvNumber() against strtod on every generated value.
+ *
+ * Build: gcc -O2 bench/bench_parse.c -o bench_parse -lpthread
+ * Usage: ./bench_parse
+ */
+#include "../platform.h"
+#include "../kvparse.h"
+
+#define LINES  4096
+#define ROUNDS 500
+
+static uint32_t rngState = 12345;
+
+static uint32_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static double nowNs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart * 1e9 / (double)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+static char data[LINES][96];
+static char serial[LINES][48];
+
+/* ---------- OLD PATH: SSCANF ---------- */
+static int scanData(const char *line, Reading *r) {
+    return sscanf(line, "DATA:TEMP=%f HUM=%f SOIL=%d WATER=%d",
+                  &r->temp, &r->hum, &r->soil, &r->water) == 4;
+}
+
+static int scanSerial(const char *line, Reading *r) {
+    return sscanf(line, "TEMP:%f,HUM:%f", &r->temp, &r->hum) == 2;
+}
+
+/* ---------- NEW PATH: KVPARSE ---------- */
+static int kvData(const char *line, Reading *r) {
+    const char *rest;
+    size_t len = strlen(line);
+    if (kvVerb(line, len, &rest) != MSG_DATA) return 0;
+    KvField f[KV_MAX_FIELDS];
+    int n = kvParse(rest, len - (size_t)(rest - line), f, KV_MAX_FIELDS);
+    return kvReading(f, n, r) == SENSOR_ALL;
+}
+
+static int kvSerial(const char *line, Reading *r) {
+    KvField f[KV_MAX_FIELDS];
+    int n = kvParse(line, strlen(line), f, KV_MAX_FIELDS);
+    return (kvReading(f, n, r) & (SENSOR_TEMP | SENSOR_HUM)) == (SENSOR_TEMP | SENSOR_HUM);
+}
+
+typedef int (*ParseFn)(const char *line, Reading *r);
+
+static double timeParser(ParseFn fn, const char *lines, size_t stride) {
+    volatile float sink = 0;
+    Reading r;
+    double t0 = nowNs();
+    for (int k = 0; k < ROUNDS; k++) {
+        for (int i = 0; i < LINES; i++) {
+            if (fn(lines + i * stride, &r)) sink += r.temp;
+        }
+    }
+    return (nowNs() - t0) / ((double)ROUNDS * LINES);
+}
+
+/* ---------- ACCURACY ---------- */
+static int checkNumbers(void) {
+    int bad = 0;
+    for (int i = 0; i < 1000000; i++) {
+        char buf[32];
+        double want, got;
+        switch (i % 3) {
+        case 0: snprintf(buf, sizeof(buf), "%.2f", (int)(rng() % 20000 - 10000) / 100.0); break;
+        case 1: snprintf(buf, sizeof(buf), "%u", rng() % 100000); break;
+        default: snprintf(buf, sizeof(buf), "%.6g", (rng() / 4294967296.0 - 0.5) * 1e6); break;
+        }
+        want = strtod(buf, NULL);
+        if (kvNumber(buf, buf + strlen(buf), &got) != (int)strlen(buf) || got != want) {
+            if (bad < 5) printf("mismatch: %s -> %.17g (strtod %.17g)\n", buf, got, want);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+/* ================= MAIN ================= */
+int main(void) {
+    for (int i = 0; i < LINES; i++) {
+        float temp = 10 + (rng() % 3000) / 100.0f;
+        float hum = 20 + (rng() % 7500) / 100.0f;
+        snprintf(data[i], sizeof(data[i]), "DATA:TEMP=%.2f HUM=%.2f SOIL=%u WATER=%u",
+                 temp, hum, rng() % 1024, rng() % 100);
+        snprintf(serial[i], sizeof(serial[i]), "TEMP:%.1f,HUM:%.1f", temp, hum);
+    }
+
+    /* both paths must agree before timing them */
+    for (int i = 0; i < LINES; i++) {
+        Reading a, b;
+        if (!scanData(data[i], &a) || !kvData(data[i], &b) ||
+            a.temp != b.temp || a.hum != b.hum || a.soil != b.soil || a.water != b.water) {
+            printf("❌ parsers disagree on \"%s\"\n", data[i]);
+            return 1;
+        }
+    }
+
+    printf("DATA    sscanf=%6.1f ns  kvparse=%6.1f ns\n",
+           timeParser(scanData, data[0], sizeof(data[0])),
+           timeParser(kvData, data[0], sizeof(data[0])));
+    printf("serial  sscanf=%6.1f ns  kvparse=%6.1f ns\n",
+           timeParser(scanSerial, serial[0], sizeof(serial[0])),
+           timeParser(kvSerial, serial[0], sizeof(serial[0])));
+
+    int bad = checkNumbers();
+    printf("%s kvNumber vs strtod: %d mismatches in 1000000 values\n",
+           bad ? "❌" : "✅", bad);
+    return bad != 0;
+}
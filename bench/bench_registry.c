@@ -0,0 +1,99 @@
+/* ================= REGISTRY BENCHMARK =================
+ * Lookup latency of the hash-indexed registry at 10, 1k and 100k
+ * nodes, by source address and by nodeId, next to the linear scan
+ * the fixed clients[] array used to do.
+ *
+ * Build: gcc -O2 bench/bench_registry.c -o bench_registry -lpthread
+ * Usage: ./bench_registry
+ */
+#include "../platform.h"
+#include "../registry.h"
+
+#define LOOKUPS 2000000
+
+static uint32_t rngState = 12345;
+
+static uint32_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static double nowNs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart * 1e9 / (double)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+/* ---------- OLD PATH: LINEAR SCAN ---------- */
+static int linearFind(Client *items, int count, const struct sockaddr_in *addr) {
+    for (int i = 0; i < count; i++) {
+        if (items[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            items[i].addr.sin_port == addr->sin_port)
+            return i;
+    }
+    return -1;
+}
+
+static void runSize(int nodes) {
+    Registry reg;
+    registryInit(&reg);
+
+    struct sockaddr_in *addrs = malloc(nodes * sizeof(*addrs));
+    Client *flat = calloc(nodes, sizeof(Client));       // the old clients[] layout
+    int *probe = malloc(LOOKUPS * sizeof(int));
+
+    for (int i = 0; i < nodes; i++) {
+        memset(&addrs[i], 0, sizeof(addrs[i]));
+        addrs[i].sin_family = AF_INET;
+        addrs[i].sin_addr.s_addr = htonl(0x0a000000 | (rng() & 0xffffff));
+        addrs[i].sin_port = htons((unsigned short)(1024 + rng() % 60000));
+        registryAdd(&reg, &addrs[i], i + 1);
+        flat[i].addr = addrs[i];
+    }
+    for (int i = 0; i < LOOKUPS; i++)
+        probe[i] = rng() % nodes;
+
+    volatile long sink = 0;
+
+    double t0 = nowNs();
+    for (int i = 0; i < LOOKUPS; i++)
+        sink += registryFindAddr(&reg, &addrs[probe[i]]);
+    double byAddr = (nowNs() - t0) / LOOKUPS;
+
+    t0 = nowNs();
+    for (int i = 0; i < LOOKUPS; i++)
+        sink += registryFindNode(&reg, probe[i] + 1);
+    double byNode = (nowNs() - t0) / LOOKUPS;
+
+    /* keep the linear scan's total work bounded at large sizes */
+    int linearLookups = nodes > 1000 ? LOOKUPS / 1000 : LOOKUPS;
+    t0 = nowNs();
+    for (int i = 0; i < linearLookups; i++)
+        sink += linearFind(flat, nodes, &addrs[probe[i]]);
+    double linear = (nowNs() - t0) / linearLookups;
+
+    printf("nodes=%-7d addr=%6.1f ns  node=%6.1f ns  linear=%10.1f ns\n",
+           nodes, byAddr, byNode, linear);
+
+    free(addrs);
+    free(flat);
+    free(probe);
+    registryFree(&reg);
+}
+
+/* ================= MAIN ================= */
+int main(void) {
+    runSize(10);
+    runSize(1000);
+    runSize(100000);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* ================= SHARED RING BENCHMARK =================
+ * Producer -> consumer handoff through shmring.h across two
+ * processes, next to the shared_data.txt write/read it replaces:
+ *   wake     one reading at a time, consumer parked on the futex;
+ *            latency from publish to the consumer holding it
+ *   burst    half a ring of readings back to back, then a pause;
+ *            consumer cost per reading and readings lost to overruns
+ * Every reading carries its number in soil/water, so gaps and repeats
+ * are caught as well as timed.
+ *
+ * Linux only.
+ * Build: gcc -O2 bench/bench_shmring.c -o bench_shmring -lpthread -lrt
+ * Usage: ./bench_shmring
+ */
+#include "../platform.h"
+#include "../shmring.h"
+#include <poll.h>
+#include <sys/wait.h>
+
+#define RING_NAME  "/bench_shmring"
+#define WAKE_COUNT 20000
+#define BURST      1000000
+#define CHUNK      (SHM_SLOTS / 2)
+#define FILE_COUNT 20000
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int cmpU64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* sleeps rather than spins, so the consumer runs even on one core */
+static void pauseNs(long ns) {
+    struct timespec ts = { 0, ns };
+    nanosleep(&ts, NULL);
+}
+
+/* ---------- CONSUMER (child) ---------- */
+static int consume(int readyFd) {
+    ShmReader rd;
+    if (shmReaderOpen(&rd, RING_NAME) != 0) return 1;
+    if (write(readyFd, "r", 1) != 1) return 1;
+
+    static uint64_t lat[WAKE_COUNT];
+    uint64_t next = 0, received = 0, bad = 0, burstNs = 0, burstGot = 0;
+    struct pollfd pfd = { rd.eventFd, POLLIN, 0 };
+    Reading r;
+
+    while (received + rd.missed < WAKE_COUNT + BURST) {
+        if (received < WAKE_COUNT) poll(&pfd, 1, 1000);   // park: measures the wakeup
+        shmReaderClear(&rd);
+
+        uint64_t t0 = nowNs(), got = 0;
+        while (shmReaderNext(&rd, &r)) {
+            uint64_t n = (uint64_t)r.soil | ((uint64_t)r.water << 16);
+            if (n < WAKE_COUNT) lat[n] = nowNs() - r.timeMs;
+            else got++;
+            if (n < next) bad++;                            // repeat or reorder
+            next = n + 1;
+            received++;
+        }
+        if (got) {
+            burstNs += nowNs() - t0;
+            burstGot += got;
+        }
+    }
+
+    qsort(lat, WAKE_COUNT, sizeof(lat[0]), cmpU64);
+    printf("wake    median %6.1f us  p99 %6.1f us  (%d readings)\n",
+           lat[WAKE_COUNT / 2] / 1e3, lat[WAKE_COUNT * 99 / 100] / 1e3, WAKE_COUNT);
+    printf("burst   %6.1f ns per reading consumed, %llu overrun, %llu out of order\n",
+           burstGot ? (double)burstNs / (double)burstGot : 0.0,
+           (unsigned long long)rd.missed, (unsigned long long)bad);
+    fflush(stdout);                     // the child leaves with _exit()
+    return bad != 0;
+}
+
+/* ---------- FILE HANDOFF (old path) ---------- */
+static void fileHandoff(void) {
+    const char *path = "/tmp/bench_shared_data.txt";
+    static uint64_t lat[FILE_COUNT];
+    char line[128];
+
+    for (int i = 0; i < FILE_COUNT; i++) {
+        uint64_t t0 = nowNs();
+        FILE *fp = fopen(path, "w");
+        if (!fp) return;
+        fprintf(fp, "TEMP=%.2f HUM=%.2f SOIL=%d WATER=%d\n", 21.5, 60.0, i, 40);
+        fclose(fp);
+
+        fp = fopen(path, "r");
+        if (!fp) return;
+        if (!fgets(line, sizeof(line), fp)) line[0] = '\0';
+        fclose(fp);
+        lat[i] = nowNs() - t0;
+    }
+    remove(path);
+
+    qsort(lat, FILE_COUNT, sizeof(lat[0]), cmpU64);
+    printf("file    median %6.1f us  p99 %6.1f us  write+read, no wakeup\n",
+           lat[FILE_COUNT / 2] / 1e3, lat[FILE_COUNT * 99 / 100] / 1e3);
+}
+
+/* ================= MAIN ================= */
+int main(void) {
+    shm_unlink(RING_NAME);
+    ShmRing *ring = shmRingCreate(RING_NAME);
+    if (!ring) {
+        printf("❌ Cannot create %s\n", RING_NAME);
+        return 1;
+    }
+
+    int ready[2];
+    if (pipe(ready) != 0) return 1;
+    pid_t child = fork();
+    if (child == 0) _exit(consume(ready[1]));
+
+    char c;
+    if (read(ready[0], &c, 1) != 1) return 1;
+
+    Reading r = { 0, 21.5f, 60.0f, 0, 0 };
+    for (uint64_t i = 0; i < WAKE_COUNT + BURST; i++) {
+        r.soil = (int)(i & 0xFFFF);
+        r.water = (int)(i >> 16);
+        r.timeMs = nowNs();             // carries ns here
+        shmRingPublish(ring, &r);
+        if (i < WAKE_COUNT) pauseNs(50000);  // let the consumer park again
+        else if ((i - WAKE_COUNT) % CHUNK == CHUNK - 1) pauseNs(200000);
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    shm_unlink(RING_NAME);
+    fileHandoff();
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -0,0 +1,343 @@
+/* ================= LOAD GENERATOR =================
+ * Replays a mix of v1 text REGISTER / HEARTBEAT / DATA packets
+ * against a running server at a fixed rate and reports, as JSON:
+ *
+ *   - achieved send rate (pps)
+ *   - DATA readings that never reached the log (drop rate), plus the
+ *     kernel's UDP receive-buffer / input error counters
+ *   - p50 / p99 / max ingest-to-log latency
+ *   - server CPU per packet (with --server-pid) and our own
+ *
+ * Each DATA packet carries a unique sequence number in SOIL, so a
+ * tail thread can match every logged line back to its send time.
+ *
+ * Build: gcc -O2 bench/loadgen.c -o loadgen -lpthread
+ * Usage: ./loadgen [--server IP] [--port P] [--nodes N] [--rate PPS]
+ *                  [--seconds S] [--mix DATA:HB:REG] [--log PATH]
+ *                  [--server-pid PID] [--node-base ID] [--out FILE]
+ */
+#include "../platform.h"
+#include <stdatomic.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define DRAIN_MS 2000
+
+typedef struct {
+    char serverIP[64];
+    int port;
+    int nodes;
+    int rate;
+    int seconds;
+    int mixData, mixHeartbeat, mixRegister;
+    const char *logPath;
+    int serverPid;
+    int nodeBase;
+    const char *outPath;
+} LoadConfig;
+
+static LoadConfig cfg = { "127.0.0.1", 8888, 100, 10000, 10, 90, 10, 0,
+                          "server_log.txt", 0, 50000, NULL };
+
+static uint64_t *sendTimeUs;       // per DATA sequence
+static uint32_t *latencyUs;        // per DATA sequence, 0 = not seen
+static long dataCapacity;
+static atomic_long dataSent;
+static atomic_long dataLogged;
+static atomic_int tailRunning = 1;
+static atomic_int tailDone = 0;
+
+/* ---------- WALL CLOCK (us) ---------- */
+static uint64_t wallUs(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    return ((((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
+
+/* ---------- LOG TAIL ----------
+ * Follows the server log from its current end and timestamps every
+ * loadgen DATA line the moment it becomes visible.
+ */
+static void matchLine(const char *line) {
+    const char *p = strstr(line, "DATA -> ");
+    if (!p) return;
+    p = strstr(p, "SOIL=");
+    if (!p) return;
+
+    long seq = strtol(p + 5, NULL, 10);
+    if (seq < 0 || seq >= dataCapacity || latencyUs[seq]) return;
+
+    uint64_t sent = sendTimeUs[seq];
+    if (!sent) return;
+
+    uint64_t now = wallUs();
+    latencyUs[seq] = (uint32_t)(now > sent ? now - sent : 1);
+    atomic_fetch_add(&dataLogged, 1);
+}
+
+THREAD_FUNC(tailLog) {
+    (void)arg;
+    FILE *fp = fopen(cfg.logPath, "r");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s\n", cfg.logPath);
+        atomic_store(&tailDone, 1);
+        THREAD_RETURN;
+    }
+    fseek(fp, 0, SEEK_END);
+
+    char line[1024];
+    size_t used = 0;
+
+    while (atomic_load(&tailRunning)) {
+        int c = fgetc(fp);
+        if (c == EOF) {
+            clearerr(fp);
+            sleepMs(1);
+            continue;
+        }
+        if (c == '\n') {
+            line[used] = '\0';
+            matchLine(line);
+            used = 0;
+        } else if (used < sizeof(line) - 1) {
+            line[used++] = (char)c;
+        }
+    }
+    fclose(fp);
+    atomic_store(&tailDone, 1);
+    THREAD_RETURN;
+}
+
+/* ---------- KERNEL UDP COUNTERS ---------- */
+typedef struct { long inErrors, rcvbufErrors; } UdpStats;
+
+static UdpStats readUdpStats(void) {
+    UdpStats st = { 0, 0 };
+#ifndef _WIN32
+    FILE *fp = fopen("/proc/net/snmp", "r");
+    if (!fp) return st;
+
+    char hdr[1024], val[1024];
+    while (fgets(hdr, sizeof(hdr), fp) && fgets(val, sizeof(val), fp)) {
+        if (strncmp(hdr, "Udp:", 4) != 0) continue;
+
+        /* header and value lines list fields in the same order */
+        char *hs, *vs;
+        char *h = strtok_r(hdr, " \n", &hs);
+        char *v = strtok_r(val, " \n", &vs);
+        while (h && v) {
+            if (!strcmp(h, "InErrors")) st.inErrors = atol(v);
+            if (!strcmp(h, "RcvbufErrors")) st.rcvbufErrors = atol(v);
+            h = strtok_r(NULL, " \n", &hs);
+            v = strtok_r(NULL, " \n", &vs);
+        }
+        break;
+    }
+    fclose(fp);
+#endif
+    return st;
+}
+
+/* ---------- PROCESS CPU (us) ---------- */
+static double processCpuUs(int pid) {
+#ifndef _WIN32
+    if (pid <= 0) {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_utime.tv_sec * 1e6 + ru.ru_utime.tv_usec +
+               ru.ru_stime.tv_sec * 1e6 + ru.ru_stime.tv_usec;
+    }
+
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    if (!fgets(buf, sizeof(buf), fp)) { fclose(fp); return -1; }
+    fclose(fp);
+
+    /* fields after the ")" of comm: state is field 3, utime 14, stime 15 */
+    char *p = strrchr(buf, ')');
+    unsigned long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                     &utime, &stime) != 2)
+        return -1;
+    return (double)(utime + stime) * 1e6 / sysconf(_SC_CLK_TCK);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+static int cmpU32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void parseArgs(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *k = argv[i], *v = argv[i + 1];
+        if      (!strcmp(k, "--server"))     snprintf(cfg.serverIP, sizeof(cfg.serverIP), "%s", v);
+        else if (!strcmp(k, "--port"))       cfg.port = atoi(v);
+        else if (!strcmp(k, "--nodes"))      cfg.nodes = atoi(v);
+        else if (!strcmp(k, "--rate"))       cfg.rate = atoi(v);
+        else if (!strcmp(k, "--seconds"))    cfg.seconds = atoi(v);
+        else if (!strcmp(k, "--log"))        cfg.logPath = v;
+        else if (!strcmp(k, "--server-pid")) cfg.serverPid = atoi(v);
+        else if (!strcmp(k, "--node-base"))  cfg.nodeBase = atoi(v);
+        else if (!strcmp(k, "--out"))        cfg.outPath = v;
+        else if (!strcmp(k, "--mix"))
+            sscanf(v, "%d:%d:%d", &cfg.mixData, &cfg.mixHeartbeat, &cfg.mixRegister);
+        else {
+            fprintf(stderr, "unknown option %s\n", k);
+            exit(1);
+        }
+    }
+    if (cfg.nodes < 1) cfg.nodes = 1;
+    if (cfg.rate < 1) cfg.rate = 1;
+    if (cfg.mixData + cfg.mixHeartbeat + cfg.mixRegister <= 0) cfg.mixData = 1;
+}
+
+/* ================= MAIN ================= */
+int main(int argc, char **argv) {
+    parseArgs(argc, argv);
+    netInit();
+
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons((unsigned short)cfg.port);
+    server.sin_addr.s_addr = inet_addr(cfg.serverIP);
+
+    long total = (long)cfg.rate * cfg.seconds;
+    dataCapacity = total + 1;
+    sendTimeUs = calloc(dataCapacity, sizeof(uint64_t));
+    latencyUs = calloc(dataCapacity, sizeof(uint32_t));
+    sock_t *socks = calloc(cfg.nodes, sizeof(sock_t));
+    if (!sendTimeUs || !latencyUs || !socks) return 1;
+
+    /* v1 text nodes are identified by source address: one socket each */
+    char buf[256];
+    for (int i = 0; i < cfg.nodes; i++) {
+        socks[i] = udpOpen(0, NET_NONBLOCK);
+        if (socks[i] == INVALID_SOCK) {
+            fprintf(stderr, "only %d sockets available\n", i);
+            return 1;
+        }
+        int len = snprintf(buf, sizeof(buf), "REGISTER:NODE:%d", cfg.nodeBase + i);
+        sendto(socks[i], buf, len, 0, (struct sockaddr*)&server, sizeof(server));
+    }
+    sleepMs(200);
+
+    startThread(tailLog, NULL);
+    sleepMs(50);
+
+    UdpStats udpBefore = readUdpStats();
+    double serverCpuBefore = processCpuUs(cfg.serverPid);
+    double selfCpuBefore = processCpuUs(0);
+
+    /* ---------- PACED SEND LOOP ---------- */
+    int mixTotal = cfg.mixData + cfg.mixHeartbeat + cfg.mixRegister;
+    long sent = 0, sendErrors = 0;
+    uint64_t start = nowMs();
+
+    while (sent < total) {
+        uint64_t elapsed = nowMs() - start;
+        long due = (long)(elapsed * (uint64_t)cfg.rate / 1000);
+        if (due > total) due = total;
+        if (sent >= due) { sleepMs(1); continue; }
+
+        for (; sent < due; sent++) {
+            int node = (int)(sent % cfg.nodes);
+            int pick = (int)(sent % mixTotal);
+            int len;
+
+            if (pick < cfg.mixData) {
+                long seq = atomic_fetch_add(&dataSent, 1);
+                len = snprintf(buf, sizeof(buf),
+                               "DATA:TEMP=%.2f HUM=%.2f SOIL=%ld WATER=%d",
+                               20 + (seq % 100) / 10.0, 55.0, seq, node % 100);
+                sendTimeUs[seq] = wallUs();
+            } else if (pick < cfg.mixData + cfg.mixHeartbeat) {
+                len = snprintf(buf, sizeof(buf), "HEARTBEAT:NODE:%d", cfg.nodeBase + node);
+            } else {
+                len = snprintf(buf, sizeof(buf), "REGISTER:NODE:%d", cfg.nodeBase + node);
+            }
+
+            if (sendto(socks[node], buf, len, 0,
+                       (struct sockaddr*)&server, sizeof(server)) != len)
+                sendErrors++;
+        }
+    }
+    double sendSecs = (nowMs() - start) / 1000.0;
+
+    /* ---------- DRAIN ---------- */
+    long expected = atomic_load(&dataSent);
+    uint64_t drainStart = nowMs();
+    while (atomic_load(&dataLogged) < expected && nowMs() - drainStart < DRAIN_MS)
+        sleepMs(10);
+    atomic_store(&tailRunning, 0);
+    while (!atomic_load(&tailDone))
+        sleepMs(1);
+
+    UdpStats udpAfter = readUdpStats();
+    double serverCpu = processCpuUs(cfg.serverPid) - serverCpuBefore;
+    double selfCpu = processCpuUs(0) - selfCpuBefore;
+
+    /* ---------- LATENCY PERCENTILES ---------- */
+    long logged = 0;
+    for (long i = 0; i < expected; i++)
+        if (latencyUs[i]) latencyUs[logged++] = latencyUs[i];
+    qsort(latencyUs, logged, sizeof(uint32_t), cmpU32);
+
+    uint32_t p50 = logged ? latencyUs[logged / 2] : 0;
+    uint32_t p99 = logged ? latencyUs[(long)(logged * 0.99)] : 0;
+    uint32_t pmax = logged ? latencyUs[logged - 1] : 0;
+
+    /* ---------- REPORT ---------- */
+    FILE *out = cfg.outPath ? fopen(cfg.outPath, "w") : stdout;
+    if (!out) out = stdout;
+
+    fprintf(out,
+        "{\n"
+        "  \"config\": {\"nodes\": %d, \"target_pps\": %d, \"seconds\": %d,"
+        " \"mix\": {\"data\": %d, \"heartbeat\": %d, \"register\": %d}},\n"
+        "  \"packets_sent\": %ld,\n"
+        "  \"send_errors\": %ld,\n"
+        "  \"achieved_pps\": %.0f,\n"
+        "  \"data_sent\": %ld,\n"
+        "  \"data_logged\": %ld,\n"
+        "  \"drop_rate\": %.6f,\n"
+        "  \"udp_rcvbuf_errors\": %ld,\n"
+        "  \"udp_in_errors\": %ld,\n"
+        "  \"latency_us\": {\"p50\": %u, \"p99\": %u, \"max\": %u},\n"
+        "  \"server_cpu_us_per_packet\": %.3f,\n"
+        "  \"loadgen_cpu_us_per_packet\": %.3f\n"
+        "}\n",
+        cfg.nodes, cfg.rate, cfg.seconds,
+        cfg.mixData, cfg.mixHeartbeat, cfg.mixRegister,
+        sent, sendErrors, sent / sendSecs,
+        expected, logged,
+        expected ? (double)(expected - logged) / expected : 0.0,
+        udpAfter.rcvbufErrors - udpBefore.rcvbufErrors,
+        udpAfter.inErrors - udpBefore.inErrors,
+        p50, p99, pmax,
+        (cfg.serverPid > 0 && serverCpuBefore >= 0 && sent) ? serverCpu / sent : -1.0,
+        sent ? selfCpu / sent : 0.0);
+
+    if (out != stdout) fclose(out);
+
+    for (int i = 0; i < cfg.nodes; i++)
+        sockClose(socks[i]);
+    free(socks);
+    free(sendTimeUs);
+    free(latencyUs);
+    netCleanup();
+    return 0;
+}
@@ -0,0 +1,984 @@
+/* Build:
+ *   Windows (MinGW): gcc client.c -o client.exe -lws2_32
+ *   Linux:           gcc -O2 client.c -o client -lpthread -lm -lrt
+ *
+ * Examples:
+ *   client --node 1 --server 192.168.1.10 --source serial:\\.\COM9
+ *   client --node 2 --server 192.168.1.10 --source file:shared_data.txt
+ *   client --node 3 --server 192.168.1.10 --source shm
+ *   client --node 1000 --nodes 10000 --server 127.0.0.1 --source synthetic
+ *   client --node 4 --server 192.168.1.10 --reliable 1
+ *   client --node 5 --server 192.168.1.10 --water-rate 4 --soil-delta 5
+ *   client --config node3.conf
+ *
+ * A config file holds the same options as key=value lines, e.g.
+ *   node=3
+ *   source=file:shared_data.txt
+ */
+#include "platform.h"
+#include <math.h>
+#include <time.h>
+#include "protocol.h"
+#include "kvparse.h"
+#include "timerwheel.h"
+#include "serialport.h"
+#include "shmring.h"
+#include "sendpolicy.h"
+
+/* ---------------- DEFAULTS ---------------- */
+#define SERVER_PORT 8888
+#define BUF_SIZE 1024
+#ifdef _WIN32
+#define COM_PORT "\\\\.\\COM9"
+#else
+#define COM_PORT "/dev/ttyACM0"
+#endif
+#define SHARED_FILE "shared_data.txt"
+#define SHARE_FILE  0x1        // serial readings go to shared_data.txt
+#define SHARE_SHM   0x2        // ... and/or the shared-memory ring
+
+/* -------- SEND CONTROL (thresholds: sendpolicy.h) -------- */
+#define HEARTBEAT_INTERVAL_MS 5000         // heartbeat every 5 sec
+#define POLL_INTERVAL_MS 5000              // read the sensor source every 5 sec
+
+/* -------- BATCHING (v2 only) -------- */
+#define BATCH_MAX       1                  // readings per datagram, 1 = send at once
+#define BATCH_DELAY_MS  30000              // max time a reading waits in a batch
+
+/* -------- RELIABILITY (v2 only) -------- */
+#define RTX_WINDOW      64                 // unacknowledged readings kept per node
+#define RTX_MAX_TRIES   6
+#define RTO_INIT_MS     300
+#define RTO_MIN_MS      20
+#define RTO_MAX_MS      5000
+
+/* -------- FAKE SENSOR RANGE -------- */
+#define SOIL_MIN  30
+#define SOIL_MAX  80
+#define WATER_MIN 20
+#define WATER_MAX 100
+#define SURGE_CHANCE  400                  // 1 in N samples starts a water surge
+#define SURGE_SAMPLES 12
+
+/* -------- SIMULATION -------- */
+#define MAX_SIM_SOCKETS 64     // v2 nodes share this many source ports
+#define TICK_MS 10
+#define STATS_INTERVAL_MS 10000
+#define TAG_SERIAL (-1)        // poller tags; sockets use their index
+#define TAG_SHM    (-2)
+
+typedef enum { SRC_SERIAL, SRC_FILE, SRC_SHM, SRC_SYNTHETIC } SourceType;
+
+typedef struct {
+    int nodeId;
+    int nodes;                 // simulated nodes, ids nodeId..nodeId+nodes-1
+    char serverIP[64];
+    int port;
+    SourceType source;
+    char sourcePath[256];
+    char shareFile[256];       // serial readings are mirrored here
+    char shmName[64];          // ... and published to this ring
+    int share;                 // SHARE_* targets
+    SendPolicy policy;         // initial policy; the server can replace it per node
+    int heartbeatMs;
+    int pollMs;
+    int batchMax;
+    int batchDelayMs;
+    int wireV2;
+    int reliable;              // keep readings until the server ACKs them
+} Config;
+
+typedef struct {
+    Reading r;
+    uint32_t seq;
+    uint64_t sentAt;
+    int tries;
+} Unacked;
+
+typedef struct {
+    int nodeId;
+    sock_t sock;
+    uint64_t lastHeartbeat;
+    uint64_t lastPoll;
+    SendPolicy policy;
+    PolicyState sendState;
+    uint32_t dataSeq;
+
+    Reading pending[BATCH_MAX_READINGS];
+    int pendingCount;
+    uint32_t pendingSeq;
+    uint64_t pendingSince;
+
+    Unacked *unacked;          // reliable mode: oldest first, RTX_WINDOW slots
+    int unackedCount;
+    float srtt;                // ms, < 0 until the first sample
+    float rttvar;
+    int rto;
+
+    float simTemp;             // synthetic source state
+    float simHum;
+    int simSoil;
+    int simWater;
+    int surge;                 // samples of rising water left
+} Node;
+
+Config cfg;
+Node *nodes;
+struct sockaddr_in serverAddr;
+TimerWheel wheel;
+int *firedNodes;           // timers fired this tick, rearmed afterwards
+int firedCount = 0;
+long packetsSent = 0;
+long readingsSent = 0;
+long acksReceived = 0;
+long retransmits = 0;
+long rtxGaveUp = 0;
+long heldBack = 0;
+long sentBy[SEND_RATE + 1];    // per SEND_* reason
+long policyUpdates = 0;
+
+SerialPort serial;
+uint64_t serialRetryAt = 0;
+ShmRing *shareRing;        // serial source: producer side
+ShmReader shmIn;           // shm source: consumer side
+
+/* ---------- RANDOM RANGE ---------- */
+int randomInRange(int min, int max) {
+    return min + rand() % (max - min + 1);
+}
+
+/* ---------- PARSE SENSOR LINE ----------
+ * "TEMP:23.5,HUM:61" from the Arduino. Returns 1 if both are present.
+ */
+int parseSensorLine(const char *line, int len, float *temp, float *hum) {
+    KvField f[KV_MAX_FIELDS];
+    Reading r;
+    int n = kvParse(line, (size_t)len, f, KV_MAX_FIELDS);
+
+    if ((kvReading(f, n, &r) & (SENSOR_TEMP | SENSOR_HUM)) !=
+        (SENSOR_TEMP | SENSOR_HUM))
+        return 0;
+    *temp = r.temp;
+    *hum = r.hum;
+    return 1;
+}
+
+/* ---------- READ SHARED FILE ---------- */
+int readSharedFile(const char *path, float *temp, float *hum,
+                   int *soil, int *water) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+
+    char line[256];
+    int ok = fgets(line, sizeof(line), fp) != NULL;
+    fclose(fp);
+    if (!ok) return 0;
+
+    KvField f[KV_MAX_FIELDS];
+    Reading r;
+    int n = kvParse(line, strlen(line), f, KV_MAX_FIELDS);
+    if (kvReading(f, n, &r) != SENSOR_ALL) return 0;
+
+    *temp = r.temp;
+    *hum = r.hum;
+    *soil = r.soil;
+    *water = r.water;
+    return 1;
+}
+
+/* ---------- WRITE SHARED FILE ---------- */
+void writeSharedFile(const char *path, float temp, float hum,
+                     int soil, int water) {
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fprintf(fp,
+            "TEMP=%.2f HUM=%.2f SOIL=%d WATER=%d\n",
+            temp, hum, soil, water
+        );
+        fclose(fp);
+    }
+}
+
+/* ---------- SYNTHETIC SENSOR ----------
+ * Slow random walks. Now and then the water level surges for a
+ * while, the way it does before a flood, so the send policy has
+ * something to catch. Serial nodes use the ground half too: the
+ * Arduino only reports temp/hum.
+ */
+void simulateGround(Node *n, int *soil, int *water) {
+    n->simSoil += rand() % 3 - 1;
+    if (n->surge > 0) {
+        n->simWater += 4;
+        n->surge--;
+    } else {
+        n->simWater += rand() % 3 - 1;
+        if (rand() % SURGE_CHANCE == 0) n->surge = SURGE_SAMPLES;
+    }
+    if (n->simSoil < SOIL_MIN)   n->simSoil = SOIL_MIN;
+    if (n->simSoil > SOIL_MAX)   n->simSoil = SOIL_MAX;
+    if (n->simWater < WATER_MIN) n->simWater = WATER_MIN;
+    if (n->simWater > WATER_MAX) n->simWater = WATER_MAX;
+
+    /* after a surge the level drains back down */
+    if (n->surge == 0 && n->simWater > (WATER_MIN + WATER_MAX) / 2 && rand() % 2)
+        n->simWater--;
+
+    *soil  = n->simSoil;
+    *water = n->simWater;
+}
+
+void readSynthetic(Node *n, float *temp, float *hum, int *soil, int *water) {
+    n->simTemp += (rand() % 21 - 10) / 20.0f;
+    n->simHum  += (rand() % 21 - 10) / 10.0f;
+    if (n->simTemp < 10) n->simTemp = 10;
+    if (n->simTemp > 40) n->simTemp = 40;
+    if (n->simHum < 20)  n->simHum = 20;
+    if (n->simHum > 95)  n->simHum = 95;
+
+    *temp  = n->simTemp;
+    *hum   = n->simHum;
+    simulateGround(n, soil, water);
+}
+
+/* ---------- SEND RAW ---------- */
+void sendRaw(Node *n, const void *buf, int len) {
+    if (sendto(n->sock, (const char*)buf, len, 0,
+               (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == len)
+        packetsSent++;
+}
+
+/* ---------- SEND CONTROL (REGISTER / HEARTBEAT) ---------- */
+void sendControl(Node *n, int type) {
+    char buffer[BUF_SIZE];
+    int len;
+
+    if (cfg.wireV2) {
+        len = encodeFrame((unsigned char*)buffer, type, n->nodeId, n->dataSeq, NULL);
+    } else {
+        if (type == FRAME_REGISTER)
+            sprintf(buffer, "REGISTER:NODE:%d", n->nodeId);
+        else
+            sprintf(buffer, "HEARTBEAT:NODE:%d", n->nodeId);
+        len = (int)strlen(buffer);
+    }
+
+    sendRaw(n, buffer, len);
+}
+
+/* ================= RELIABLE MODE =================
+ * With --reliable 1 DATA/BATCH frames carry FRAME_ACK_REQ and every
+ * reading stays in the node's window until a selective ACK from the
+ * server covers it. A reading that outlives its timeout goes out
+ * again as a single DATA frame. The timeout follows RFC 6298: SRTT +
+ * 4 RTTVAR, doubled per retry, and Karn's rule (no RTT samples from
+ * retransmitted readings). The window is bounded: when it is full, or
+ * a reading has had RTX_MAX_TRIES tries, the oldest is given up and
+ * counted, so a dead server costs memory only up to the window.
+ */
+uint64_t rtxDeadline(const Node *n, const Unacked *u) {
+    uint64_t rto = (uint64_t)n->rto << (u->tries - 1);
+    return u->sentAt + (rto > RTO_MAX_MS ? RTO_MAX_MS : rto);
+}
+
+void trackUnacked(Node *n, const Reading *r, uint32_t seq, uint64_t now) {
+    if (n->unackedCount == RTX_WINDOW) {
+        memmove(n->unacked, n->unacked + 1, (RTX_WINDOW - 1) * sizeof(Unacked));
+        n->unackedCount--;
+        rtxGaveUp++;
+    }
+    Unacked *u = &n->unacked[n->unackedCount++];
+    u->r = *r;
+    u->seq = seq;
+    u->sentAt = now;
+    u->tries = 1;
+}
+
+void retransmit(Node *n, Unacked *u, uint64_t now) {
+    unsigned char frame[FRAME_MAX_SIZE];
+    int len = encodeFrame(frame, FRAME_DATA, n->nodeId, u->seq, &u->r);
+    frameRequestAck(frame);
+    sendRaw(n, frame, len);
+    u->sentAt = now;
+    u->tries++;
+    retransmits++;
+}
+
+void rttSample(Node *n, float rtt) {
+    if (n->srtt < 0) {
+        n->srtt = rtt;
+        n->rttvar = rtt / 2;
+    } else {
+        n->rttvar = 0.75f * n->rttvar + 0.25f * fabsf(n->srtt - rtt);
+        n->srtt = 0.875f * n->srtt + 0.125f * rtt;
+    }
+    float rto = n->srtt + fmaxf((float)TICK_MS, 4 * n->rttvar);
+    n->rto = rto < RTO_MIN_MS ? RTO_MIN_MS : rto > RTO_MAX_MS ? RTO_MAX_MS : (int)rto;
+}
+
+/* cum: everything below it arrived; bit k of sack: cum + 1 + k did. */
+void onAck(Node *n, uint32_t cum, uint64_t sack, uint64_t now) {
+    uint64_t newest = 0;       // send time of the newest first-try reading acked
+    int kept = 0;
+
+    for (int i = 0; i < n->unackedCount; i++) {
+        Unacked *u = &n->unacked[i];
+        int32_t d = (int32_t)(u->seq - cum);
+        if (d < 0 || (d >= 1 && d <= 64 && (sack >> (d - 1) & 1))) {
+            if (u->tries == 1 && u->sentAt > newest) newest = u->sentAt;
+            continue;
+        }
+        n->unacked[kept++] = *u;
+    }
+    n->unackedCount = kept;
+    if (newest) rttSample(n, (float)(now - newest));
+
+    /* fast retransmit: a hole below a SACKed reading was lost, unless
+       it was sent too recently to have arrived yet */
+    if (!sack) return;
+    int top = 63;
+    while (!(sack >> top & 1)) top--;
+    uint32_t sacked = cum + 1 + (uint32_t)top;
+
+    for (int i = 0; i < n->unackedCount; i++) {
+        Unacked *u = &n->unacked[i];
+        if ((int32_t)(u->seq - sacked) < 0 && u->tries == 1 &&
+            (float)(now - u->sentAt) >= n->srtt)
+            retransmit(n, u, now);
+    }
+}
+
+/* Resends what timed out, gives up on what ran out of tries. */
+void checkRetransmits(Node *n, uint64_t now) {
+    int kept = 0;
+    for (int i = 0; i < n->unackedCount; i++) {
+        Unacked *u = &n->unacked[i];
+        if (now >= rtxDeadline(n, u)) {
+            if (u->tries >= RTX_MAX_TRIES) {
+                rtxGaveUp++;
+                continue;
+            }
+            retransmit(n, u, now);
+        }
+        n->unacked[kept++] = *u;
+    }
+    n->unackedCount = kept;
+}
+
+/* ================= DOWNLINK =================
+ * v2 sockets are read whenever they are readable: ACKs (reliable
+ * mode) and POLICY updates. A POLICY frame is answered with its
+ * version every time it arrives, since an earlier answer may have
+ * been lost; the server resends until it sees one.
+ */
+void onPolicy(Node *n, const unsigned char *buf, int len, uint32_t version) {
+    PolicyUpdate u;
+    if (decodePolicy(buf, len, &u) != 0) return;
+
+    if (version != n->policy.version) {
+        policyApply(&n->policy, &u);
+        n->policy.version = version;
+        policyUpdates++;
+        if (cfg.nodes == 1) {
+            char text[256];
+            policyDescribe(&u, text, sizeof(text));
+            printf("🛠️ Send policy v%u: %s\n", version, text);
+        }
+    }
+
+    unsigned char ack[FRAME_HEADER_SIZE];
+    sendRaw(n, ack, encodeFrame(ack, FRAME_POLICY, n->nodeId, version, NULL));
+}
+
+/* Reads every datagram waiting on a (non-blocking) socket. */
+void drainDownlink(sock_t sock, uint64_t now) {
+    unsigned char buf[MAX_DATAGRAM];
+    int len;
+    while ((len = recv(sock, (char*)buf, sizeof(buf), 0)) > 0) {
+        FrameHeader h;
+        if (decodeFrame(buf, len, &h, NULL, 0) != 0) continue;
+        uint32_t idx = h.nodeId - (uint32_t)cfg.nodeId;
+        if (idx >= (uint32_t)cfg.nodes) continue;
+
+        if (h.type == FRAME_ACK && cfg.reliable) {
+            acksReceived++;
+            onAck(&nodes[idx], h.seq, h.sack, now);
+        } else if (h.type == FRAME_POLICY) {
+            onPolicy(&nodes[idx], buf, len, h.seq);
+        }
+    }
+}
+
+/* ---------- FLUSH BATCH ----------
+ * Sends the pending readings as one DATA (single) or BATCH frame.
+ */
+void flushBatch(Node *n) {
+    unsigned char frame[FRAME_MAX_SIZE];
+    int len;
+
+    if (n->pendingCount == 0) return;
+
+    if (n->pendingCount == 1)
+        len = encodeFrame(frame, FRAME_DATA, n->nodeId, n->pendingSeq, &n->pending[0]);
+    else
+        len = encodeBatch(frame, n->nodeId, n->pendingSeq, n->pending, n->pendingCount);
+
+    if (cfg.reliable) {
+        uint64_t now = nowMs();
+        frameRequestAck(frame);
+        for (int i = 0; i < n->pendingCount; i++)
+            trackUnacked(n, &n->pending[i], n->pendingSeq + (uint32_t)i, now);
+    }
+
+    sendRaw(n, frame, len);
+    readingsSent += n->pendingCount;
+    n->pendingCount = 0;
+}
+
+/* ---------- SEND READING ----------
+ * v2: queued into the current batch, sent once batchMax readings
+ * are waiting or the oldest is batchDelayMs old.
+ * v1: NODE:, DATA:, EOF text triple, sent at once.
+ */
+void sendReading(Node *n, float temp, float hum, int soil, int water, uint64_t now) {
+    char buffer[BUF_SIZE];
+
+    if (cfg.wireV2) {
+        if (n->pendingCount == 0) {
+            n->pendingSeq = n->dataSeq;
+            n->pendingSince = now;
+        }
+
+        Reading *r = &n->pending[n->pendingCount++];
+        r->timeMs = (uint64_t)time(NULL) * 1000;
+        r->temp = temp;
+        r->hum = hum;
+        r->soil = soil;
+        r->water = water;
+        n->dataSeq++;
+
+        if (n->pendingCount >= cfg.batchMax)
+            flushBatch(n);
+        return;
+    }
+
+    sprintf(buffer, "NODE:%d", n->nodeId);
+    sendRaw(n, buffer, (int)strlen(buffer));
+
+    /* NODE/SEQ let the server place DATA that overtook NODE: and
+       account for loss; older servers ignore the extra fields */
+    sprintf(buffer,
+        "DATA:TEMP=%.2f HUM=%.2f SOIL=%d WATER=%d NODE=%d SEQ=%u",
+        temp, hum, soil, water, n->nodeId, n->dataSeq++
+    );
+    sendRaw(n, buffer, (int)strlen(buffer));
+
+    sendRaw(n, "EOF", 3);
+    readingsSent++;
+}
+
+/* ---------- HANDLE SAMPLE ----------
+ * Every sample goes through the node's send policy (sendpolicy.h);
+ * only those it lets through reach the network.
+ */
+void handleSample(Node *n, float temp, float hum, int soil, int water, uint64_t now) {
+    int verbose = cfg.nodes == 1;
+    Reading sample = { 0, temp, hum, soil, water };
+
+    int why = policyDecide(&n->policy, &n->sendState, &sample, now);
+    if (why == SEND_NONE) {
+        heldBack++;
+        if (verbose) printf("⏸️ No significant change\n");
+        return;
+    }
+    sentBy[why]++;
+
+    if (cfg.source == SRC_SERIAL) {
+        printf("🌱 Soil: %d%%  💧 Water: %d%%\n", soil, water);
+        if (cfg.share & SHARE_FILE)
+            writeSharedFile(cfg.shareFile, temp, hum, soil, water);
+        if (shareRing) {
+            Reading r = { wallMs(), temp, hum, soil, water };
+            shmRingPublish(shareRing, &r);
+        }
+    }
+    if (verbose) printf("🚀 Sending data to server\n");
+
+    sendReading(n, temp, hum, soil, water, now);
+    policySent(&n->sendState, &sample, now);
+}
+
+/* File and synthetic sources are sampled on the poll timer; serial
+   and shm readings arrive as events. */
+int polledSource(void) {
+    return cfg.source == SRC_FILE || cfg.source == SRC_SYNTHETIC;
+}
+
+void pollSource(Node *n, uint64_t now) {
+    float temp, hum;
+    int soil, water;
+
+    if (cfg.source == SRC_FILE) {
+        if (!readSharedFile(cfg.sourcePath, &temp, &hum, &soil, &water)) return;
+        if (cfg.nodes == 1)
+            printf("📥 File -> T:%.2f H:%.2f S:%d W:%d\n", temp, hum, soil, water);
+    } else {
+        readSynthetic(n, &temp, &hum, &soil, &water);
+    }
+    handleSample(n, temp, hum, soil, water, now);
+}
+
+/* ---------- NODE TIMER ----------
+ * One wheel timer per node, armed for its earliest pending job:
+ * heartbeat, sensor poll, batch flush or retransmit.
+ */
+void rearmNode(int idx) {
+    Node *n = &nodes[idx];
+    uint64_t due = n->lastHeartbeat + cfg.heartbeatMs;
+    uint64_t poll = n->lastPoll + cfg.pollMs;
+    if (polledSource() && poll < due) due = poll;
+    if (n->pendingCount > 0) {
+        uint64_t flush = n->pendingSince + cfg.batchDelayMs;
+        if (flush < due) due = flush;
+    }
+    for (int i = 0; i < n->unackedCount; i++) {
+        uint64_t rtx = rtxDeadline(n, &n->unacked[i]);
+        if (rtx < due) due = rtx;
+    }
+    wheelSchedule(&wheel, idx, due);
+}
+
+void onNodeTimer(void *ctx, int idx) {
+    (void)ctx;
+    Node *n = &nodes[idx];
+    uint64_t now = nowMs();
+
+    /* ---------- HEARTBEAT ---------- */
+    if (now - n->lastHeartbeat >= (uint64_t)cfg.heartbeatMs) {
+        sendControl(n, FRAME_HEARTBEAT);
+        n->lastHeartbeat = now;
+    }
+
+    /* ---------- SENSOR ---------- */
+    if (polledSource() && now - n->lastPoll >= (uint64_t)cfg.pollMs) {
+        pollSource(n, nowMs());
+        n->lastPoll = now;
+    }
+
+    /* ---------- BATCH DEADLINE ---------- */
+    if (n->pendingCount > 0 && now - n->pendingSince >= (uint64_t)cfg.batchDelayMs)
+        flushBatch(n);
+
+    /* ---------- RETRANSMIT ---------- */
+    if (n->unackedCount > 0)
+        checkRetransmits(n, now);
+
+    firedNodes[firedCount++] = idx;
+}
+
+/* ---------- SERIAL SOURCE ----------
+ * Event driven: the port wakes the loop, every complete line is
+ * handled at once, and a vanished port is reopened on a retry timer.
+ */
+int watchSerial(Poller *p) {
+#if SERIAL_POLLABLE
+    return pollerAdd(p, serial.fd, TAG_SERIAL);
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+void drainSerial(Poller *p, uint64_t now) {
+    char line[SERIAL_LINE_MAX];
+    int got, len, lines = 0;
+
+    if (!serial.open) {
+        if (now < serialRetryAt) return;
+        if (!serialOpen(&serial, cfg.sourcePath) || watchSerial(p) != 0) {
+            serialClose(&serial);
+            serialRetryAt = now + SERIAL_RETRY_MS;
+            return;
+        }
+        printf("✅ Arduino connected\n");
+    }
+
+    do {
+        got = serialFill(&serial);
+        while ((len = serialLine(&serial, line, sizeof(line))) >= 0) {
+            float temp, hum;
+            if (!parseSensorLine(line, len, &temp, &hum)) continue;
+            printf("📡 Read -> Temp: %.2f°C  Hum: %.2f%%\n", temp, hum);
+
+            int soil, water;
+            simulateGround(&nodes[0], &soil, &water);
+            handleSample(&nodes[0], temp, hum, soil, water, now);
+            lines++;
+        }
+    } while (got > 0);
+
+    if (got < 0) {
+        printf("⏳ Arduino disconnected, retrying...\n");
+        serialClose(&serial);
+        serialRetryAt = now + SERIAL_RETRY_MS;
+    }
+    if (lines) rearmNode(0);        // a flush or retransmit may be due sooner
+}
+
+/* ---------- SHARED-MEMORY SOURCE ----------
+ * Every reading the serial node publishes, in order, to every node
+ * this process simulates.
+ */
+void drainShm(uint64_t now) {
+    Reading r;
+    uint64_t missed = shmIn.missed;
+    int got = 0;
+
+    shmReaderClear(&shmIn);
+    while (shmReaderNext(&shmIn, &r)) {
+        if (cfg.nodes == 1)
+            printf("📥 Shm -> T:%.2f H:%.2f S:%d W:%d\n", r.temp, r.hum, r.soil, r.water);
+        for (int i = 0; i < cfg.nodes; i++)
+            handleSample(&nodes[i], r.temp, r.hum, r.soil, r.water, now);
+        got = 1;
+    }
+
+    if (shmIn.missed != missed)
+        printf("⚠️ Fell behind the shared ring, %llu readings skipped\n",
+               (unsigned long long)(shmIn.missed - missed));
+    if (got)
+        for (int i = 0; i < cfg.nodes; i++) rearmNode(i);
+}
+
+/* ---------- WAIT FOR EVENTS ----------
+ * Sleeps until the next timer, an ACK, serial input or a shared
+ * reading. Without any of those there is nothing to wait on but the
+ * clock.
+ */
+void waitEvents(Poller *p, int usePoller, sock_t *socks, int timeoutMs) {
+    uint64_t now = nowMs();
+
+    if (cfg.source == SRC_SERIAL) {
+        uint64_t retry = serialRetryAt > now ? serialRetryAt - now : 0;
+        if (!serial.open && (timeoutMs < 0 || (uint64_t)timeoutMs > retry))
+            timeoutMs = (int)retry;
+        if (!SERIAL_POLLABLE && (timeoutMs < 0 || timeoutMs > SERIAL_POLL_MS))
+            timeoutMs = SERIAL_POLL_MS;
+    }
+
+    if (!usePoller) {
+        if (timeoutMs > 0) sleepMs((unsigned int)timeoutMs);
+    } else {
+        int ready[POLLER_MAX];
+        int count = pollerWait(p, ready, POLLER_MAX, timeoutMs);
+        now = nowMs();
+        for (int i = 0; i < count; i++) {
+            if (ready[i] == TAG_SERIAL) drainSerial(p, now);
+            else if (ready[i] == TAG_SHM) drainShm(now);
+            else drainDownlink(socks[ready[i]], now);
+        }
+    }
+
+    if (cfg.source == SRC_SERIAL && (!serial.open || !SERIAL_POLLABLE))
+        drainSerial(p, nowMs());
+}
+
+/* ---------- CONFIG ---------- */
+void setDefaults(Config *c) {
+    memset(c, 0, sizeof(*c));
+    c->nodeId = 1;
+    c->nodes = 1;
+    c->port = SERVER_PORT;
+    c->source = SRC_SYNTHETIC;
+    strcpy(c->shareFile, SHARED_FILE);
+    strcpy(c->shmName, SHM_NAME);
+    c->share = SHARE_FILE | SHARE_SHM;
+    policyDefault(&c->policy);
+    c->heartbeatMs = HEARTBEAT_INTERVAL_MS;
+    c->pollMs = POLL_INTERVAL_MS;
+    c->batchMax = BATCH_MAX;
+    c->batchDelayMs = BATCH_DELAY_MS;
+    c->wireV2 = 1;
+}
+
+int loadConfigFile(Config *c, const char *path);
+
+/* Applies one option; returns 0 if the key is unknown. Send policy
+   keys (water-rate, temp-delta, send-interval-ms, ...) go to
+   sendpolicy.h. */
+int setOption(Config *c, const char *key, const char *val) {
+    PolicyUpdate u = {0};
+    char *end;
+    double num = strtod(val, &end);
+
+    if (*end == '\0' && end != val && policySetKey(&u, key, (int)strlen(key), num))
+        policyApply(&c->policy, &u);
+    else if (!strcmp(key, "node"))           c->nodeId = atoi(val);
+    else if (!strcmp(key, "nodes"))          c->nodes = atoi(val);
+    else if (!strcmp(key, "server"))         snprintf(c->serverIP, sizeof(c->serverIP), "%s", val);
+    else if (!strcmp(key, "port"))           c->port = atoi(val);
+    else if (!strcmp(key, "share-file"))     snprintf(c->shareFile, sizeof(c->shareFile), "%s", val);
+    else if (!strcmp(key, "share")) {
+        if      (!strcmp(val, "file")) c->share = SHARE_FILE;
+        else if (!strcmp(val, "shm"))  c->share = SHARE_SHM;
+        else if (!strcmp(val, "both")) c->share = SHARE_FILE | SHARE_SHM;
+        else return 0;
+    }
+    else if (!strcmp(key, "heartbeat-ms"))   c->heartbeatMs = atoi(val);
+    else if (!strcmp(key, "poll-ms"))        c->pollMs = atoi(val);
+    else if (!strcmp(key, "batch"))          c->batchMax = atoi(val);
+    else if (!strcmp(key, "batch-delay-ms")) c->batchDelayMs = atoi(val);
+    else if (!strcmp(key, "wire")) {
+        if      (!strcmp(val, "1")) c->wireV2 = 0;
+        else if (!strcmp(val, "2")) c->wireV2 = 1;
+        else return 0;
+    }
+    else if (!strcmp(key, "reliable"))       c->reliable = atoi(val) != 0;
+    else if (!strcmp(key, "config"))         return loadConfigFile(c, val);
+    else if (!strcmp(key, "source")) {
+        if (!strncmp(val, "serial", 6)) {
+            c->source = SRC_SERIAL;
+            snprintf(c->sourcePath, sizeof(c->sourcePath), "%s",
+                     val[6] == ':' ? val + 7 : COM_PORT);
+        } else if (!strncmp(val, "file", 4)) {
+            c->source = SRC_FILE;
+            snprintf(c->sourcePath, sizeof(c->sourcePath), "%s",
+                     val[4] == ':' ? val + 5 : SHARED_FILE);
+        } else if (!strncmp(val, "shm", 3)) {
+            c->source = SRC_SHM;
+            if (val[3] == ':')
+                snprintf(c->shmName, sizeof(c->shmName), "%s", val + 4);
+        } else if (!strcmp(val, "synthetic")) {
+            c->source = SRC_SYNTHETIC;
+        } else {
+            return 0;
+        }
+    }
+    else return 0;
+    return 1;
+}
+
+int loadConfigFile(Config *c, const char *path) {
+    char line[512];
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        printf("❌ Cannot open config %s\n", path);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') continue;
+
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        if (!setOption(c, line, eq + 1))
+            printf("⚠️ Unknown config key: %s\n", line);
+    }
+    fclose(fp);
+    return 1;
+}
+
+void usage(const char *prog) {
+    printf("Usage: %s [--node ID] [--nodes N] [--server IP] [--port P]\n"
+           "          [--source serial[:DEV]|file[:PATH]|shm[:NAME]|synthetic]\n"
+           "          [--share-file PATH] [--share file|shm|both]\n"
+           "          [--heartbeat-ms MS] [--poll-ms MS]\n"
+           "          [--SENSOR-delta V] [--SENSOR-deadband V] [--SENSOR-rate V_PER_MIN]\n"
+           "            SENSOR: temp hum soil water, 0 = rule off\n"
+           "          [--max-silence-ms MS] (alias --send-interval-ms)\n"
+           "          [--batch N] [--batch-delay-ms MS] [--wire 1|2]\n"
+           "          [--reliable 0|1]\n"
+           "          [--config FILE]\n", prog);
+    exit(1);
+}
+
+void parseArgs(int argc, char **argv) {
+    setDefaults(&cfg);
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc ||
+            !setOption(&cfg, argv[i] + 2, argv[i + 1]))
+            usage(argv[0]);
+        i++;
+    }
+
+    if (cfg.nodes < 1) cfg.nodes = 1;
+    if (cfg.batchMax < 1) cfg.batchMax = 1;
+    if (cfg.batchMax > BATCH_MAX_READINGS) cfg.batchMax = BATCH_MAX_READINGS;
+    if (cfg.source == SRC_SERIAL && cfg.nodes > 1) {
+        printf("❌ A serial source drives exactly one node\n");
+        exit(1);
+    }
+    if (cfg.source == SRC_SHM && !SHM_SUPPORTED) {
+        printf("⚠️ No shared memory on this platform, reading %s\n", cfg.shareFile);
+        cfg.source = SRC_FILE;
+        snprintf(cfg.sourcePath, sizeof(cfg.sourcePath), "%s", cfg.shareFile);
+    }
+    if (cfg.reliable && !cfg.wireV2) {
+        printf("❌ Reliable mode needs the v2 wire format\n");
+        exit(1);
+    }
+}
+
+/* ================= MAIN ================= */
+int main(int argc, char **argv) {
+    parseArgs(argc, argv);
+    srand((unsigned int)time(NULL));
+    netInit();
+
+    if (cfg.serverIP[0] == '\0') {
+        printf("Enter Server IP: ");
+        if (scanf("%63s", cfg.serverIP) != 1) return 1;
+    }
+
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons((unsigned short)cfg.port);
+    serverAddr.sin_addr.s_addr = inet_addr(cfg.serverIP);
+
+    /* v1 text nodes are identified by source address, so each needs
+       its own socket; v2 frames carry the nodeId and share a pool. */
+    int sockCount = cfg.nodes;
+    if (cfg.wireV2 && sockCount > MAX_SIM_SOCKETS) sockCount = MAX_SIM_SOCKETS;
+
+    sock_t *socks = calloc(sockCount, sizeof(sock_t));
+    nodes = calloc(cfg.nodes, sizeof(Node));
+    firedNodes = calloc(cfg.nodes, sizeof(int));
+    if (!socks || !nodes || !firedNodes) return 1;
+
+    /* reliable mode and serial / shm sources sleep in the poller, so
+       ACKs and readings are handled as they arrive; everything in it
+       is drained without blocking */
+    Poller poller;
+    int usePoller = cfg.wireV2 || cfg.source == SRC_SHM ||
+                    (SERIAL_POLLABLE && cfg.source == SRC_SERIAL);
+    if (usePoller && pollerInit(&poller) != 0) return 1;
+
+    for (int i = 0; i < sockCount; i++) {
+        socks[i] = udpOpen(0, cfg.nodes > 1 || cfg.wireV2 ? NET_NONBLOCK : 0);
+        if (socks[i] == INVALID_SOCK ||
+            (cfg.wireV2 && pollerAdd(&poller, socks[i], i) != 0)) {
+            printf("❌ Could only open %d of %d sockets\n", i, sockCount);
+            return 1;
+        }
+    }
+
+    if (cfg.source == SRC_SERIAL) {
+        printf("Waiting for Arduino...\n");
+
+        while (!serialOpen(&serial, cfg.sourcePath)) {
+            printf("⏳ Arduino not connected, retrying...\n");
+            sleepMs(SERIAL_RETRY_MS);
+        }
+        if (watchSerial(&poller) != 0) return 1;
+
+        printf("✅ Arduino connected\n");
+
+        if (cfg.share & SHARE_SHM) {
+            shareRing = shmRingCreate(cfg.shmName);
+            if (shareRing)
+                printf("🔗 Publishing readings to shared memory %s\n", cfg.shmName);
+            else if (SHM_SUPPORTED)
+                printf("⚠️ Cannot create shared memory %s\n", cfg.shmName);
+        }
+    } else if (cfg.source == SRC_SHM) {
+        printf("Waiting for shared readings on %s...\n", cfg.shmName);
+
+        while (shmReaderOpen(&shmIn, cfg.shmName) != 0) {
+            printf("⏳ No producer yet, retrying...\n");
+            sleepMs(SERIAL_RETRY_MS);
+        }
+        if (pollerAdd(&poller, shmIn.eventFd, TAG_SHM) != 0) return 1;
+
+        printf("✅ Attached to shared readings\n");
+    } else if (cfg.source == SRC_FILE) {
+        printf("Waiting to read shared file...\n");
+    }
+
+    /* ---------- REGISTER ---------- */
+    uint64_t now = nowMs();
+    wheelInit(&wheel, TICK_MS, cfg.pollMs + cfg.heartbeatMs + cfg.batchDelayMs +
+              (cfg.reliable ? RTO_MAX_MS : 0), now);
+
+    for (int i = 0; i < cfg.nodes; i++) {
+        Node *n = &nodes[i];
+        n->nodeId = cfg.nodeId + i;
+        n->sock = socks[i % sockCount];
+        n->policy = cfg.policy;
+        n->simTemp = 20 + rand() % 10;
+        n->simHum = 50 + rand() % 20;
+        n->simSoil = randomInRange(SOIL_MIN, SOIL_MAX);
+        n->simWater = randomInRange(WATER_MIN, (WATER_MIN + WATER_MAX) / 2);
+        n->srtt = -1;
+        n->rto = RTO_INIT_MS;
+        if (cfg.reliable) {
+            n->unacked = calloc(RTX_WINDOW, sizeof(Unacked));
+            if (!n->unacked) return 1;
+        }
+
+        /* spread simulated nodes over one poll / heartbeat period */
+        uint64_t offset = cfg.nodes > 1 ? (uint64_t)(rand() % cfg.pollMs) : 0;
+        n->lastPoll = now + offset - cfg.pollMs;
+        n->lastHeartbeat = now + offset - cfg.heartbeatMs;
+
+        sendControl(n, FRAME_REGISTER);
+        rearmNode(i);
+    }
+
+    if (cfg.nodes == 1)
+        printf("✅ Node %d registered\n", cfg.nodeId);
+    else
+        printf("✅ Simulating nodes %d..%d (%s, %d sockets)\n",
+               cfg.nodeId, cfg.nodeId + cfg.nodes - 1,
+               cfg.wireV2 ? "v2" : "v1", sockCount);
+    if (cfg.reliable)
+        printf("🔁 Reliable mode: window %d, RTO %d..%d ms\n",
+               RTX_WINDOW, RTO_MIN_MS, RTO_MAX_MS);
+
+    /* ---------- EVENT LOOP ---------- */
+    uint64_t lastStats = now;
+    long lastPackets = 0;
+
+    while (1) {
+        int timeout = wheelNextTimeout(&wheel, nowMs());
+        waitEvents(&poller, usePoller, socks, timeout);
+
+        now = nowMs();
+        firedCount = 0;
+        wheelAdvance(&wheel, now, onNodeTimer, NULL);
+
+        /* rearm after advancing: fire() must not target the current tick */
+        for (int i = 0; i < firedCount; i++)
+            rearmNode(firedNodes[i]);
+
+        if (cfg.nodes > 1 && now - lastStats >= STATS_INTERVAL_MS) {
+            printf("📊 %ld packets (%.0f pps), %ld readings sent\n",
+                   packetsSent,
+                   (packetsSent - lastPackets) * 1000.0 / (now - lastStats),
+                   readingsSent);
+            if (cfg.reliable)
+                printf("🔁 %ld acks, %ld retransmitted, %ld given up\n",
+                       acksReceived, retransmits, rtxGaveUp);
+            printf("📉 %ld samples held back; sent on rate %ld, delta %ld, "
+                   "silence %ld, first %ld; %ld policy updates\n",
+                   heldBack, sentBy[SEND_RATE], sentBy[SEND_DELTA],
+                   sentBy[SEND_SILENCE], sentBy[SEND_FIRST], policyUpdates);
+            lastPackets = packetsSent;
+            lastStats = now;
+        }
+    }
+
+    serialClose(&serial);
+    if (usePoller) pollerClose(&poller);
+    for (int i = 0; i < sockCount; i++)
+        sockClose(socks[i]);
+    for (int i = 0; i < cfg.nodes; i++)
+        free(nodes[i].unacked);
+    free(socks);
+    free(nodes);
+    free(firedNodes);
+    wheelFree(&wheel);
+    netCleanup();
+    return 0;
+}
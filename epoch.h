@@ -0,0 +1,123 @@
+/* ================= EPOCH RECLAMATION =================
+ * Frees memory that lock-free readers may still be looking at, once
+ * none of them can be. A reader brackets its access with
+ * epochEnter() / epochExit(); a writer that has unpublished a block
+ * hands it to epochRetire() instead of free().
+ *
+ * Each thread claims a slot the first time it reads. epochEnter()
+ * copies the global epoch into the slot, epochExit() clears it.
+ * Retiring bumps the global epoch and tags the block with the value
+ * it had; the block is freed once no slot holds an epoch at or below
+ * its tag, i.e. every reader that could have seen it has left.
+ *
+ * Sections must be short and must not nest. Retiring is for rare
+ * structural changes: the retire list sits behind a spin flag.
+ */
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include "platform.h"
+#include <stdatomic.h>
+
+#define EPOCH_THREADS 128
+
+typedef struct {
+    _Atomic uint64_t epoch;             // 0 = not reading
+    atomic_int used;
+    char pad[64 - sizeof(uint64_t) - sizeof(int)];  // one slot per cache line
+} EpochSlot;
+
+typedef struct EpochNode {
+    void *p;
+    void (*freeFn)(void *);
+    uint64_t tag;
+    struct EpochNode *next;
+} EpochNode;
+
+static EpochSlot epochSlots[EPOCH_THREADS];
+static _Atomic uint64_t epochGlobal = 1;
+static atomic_int epochOverflow;        // readers without a slot
+static atomic_flag epochListLock = ATOMIC_FLAG_INIT;
+static EpochNode *epochRetired;
+static atomic_int epochPending;
+static THREAD_LOCAL int epochMine = -1;
+
+/* ---------- READ SIDE ----------
+ * Threads past EPOCH_THREADS share one counter; while any of them is
+ * inside, nothing is freed.
+ */
+static inline int epochSlot(void) {
+    if (epochMine >= 0) return epochMine;
+    for (int i = 0; i < EPOCH_THREADS; i++) {
+        int free = 0;
+        if (atomic_compare_exchange_strong(&epochSlots[i].used, &free, 1))
+            return epochMine = i;
+    }
+    return -1;
+}
+
+static inline void epochEnter(void) {
+    int i = epochSlot();
+    if (i < 0) atomic_fetch_add(&epochOverflow, 1);
+    else atomic_store(&epochSlots[i].epoch, atomic_load(&epochGlobal));
+}
+
+static inline void epochExit(void) {
+    if (epochMine < 0) atomic_fetch_sub(&epochOverflow, 1);
+    else atomic_store(&epochSlots[epochMine].epoch, 0);
+}
+
+/* ---------- RECLAIM ----------
+ * Frees whatever no reader can still hold. Cheap when nothing is
+ * pending, so it can run from an idle loop.
+ */
+static inline void epochReclaim(void) {
+    if (atomic_load(&epochPending) == 0) return;
+    if (atomic_flag_test_and_set(&epochListLock)) return;   // someone else is at it
+
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < EPOCH_THREADS; i++) {
+        uint64_t e = atomic_load(&epochSlots[i].epoch);
+        if (e && e < oldest) oldest = e;
+    }
+
+    EpochNode *done = NULL;
+    if (atomic_load(&epochOverflow) == 0) {
+        EpochNode **pp = &epochRetired;
+        while (*pp) {
+            EpochNode *n = *pp;
+            if (n->tag < oldest) { *pp = n->next; n->next = done; done = n; }
+            else pp = &n->next;
+        }
+    }
+    atomic_flag_clear(&epochListLock);
+
+    while (done) {
+        EpochNode *n = done;
+        done = n->next;
+        n->freeFn(n->p);
+        free(n);
+        atomic_fetch_sub(&epochPending, 1);
+    }
+}
+
+/* ---------- RETIRE ----------
+ * p must already be unreachable for new readers.
+ */
+static inline void epochRetire(void *p, void (*freeFn)(void *)) {
+    EpochNode *n = malloc(sizeof(EpochNode));
+    if (!n) return;                     // leak rather than free too early
+    n->p = p;
+    n->freeFn = freeFn;
+    n->tag = atomic_fetch_add(&epochGlobal, 1);
+
+    while (atomic_flag_test_and_set(&epochListLock)) {}
+    n->next = epochRetired;
+    epochRetired = n;
+    atomic_fetch_add(&epochPending, 1);
+    atomic_flag_clear(&epochListLock);
+
+    epochReclaim();
+}
+
+#endif
@@ -0,0 +1,178 @@
+/* ================= FLOOD DETECTION =================
+ * The dashboard's flood rules, evaluated on the server as each reading
+ * is stored, with constant state per node:
+ *
+ *   level   water >= FLOOD_WARNING / FLOOD_CRITICAL; it drops a level
+ *           only once water is FLOOD_HYSTERESIS below the threshold,
+ *           so a level hovering at a line does not flap
+ *   risk    water*0.5 + soil*0.3 + hum*0.2, plus its EWMA
+ *   rate    water change per minute: least-squares slope over the
+ *           last FLOOD_WINDOW readings within FLOOD_WINDOW_MS. Flash
+ *           flood above FLOOD_FLASH_RATE, cleared below
+ *           FLOOD_FLASH_CLEAR
+ *
+ * The dashboard took the rate from the last two readings it had
+ * fetched; a fitted slope over a short window does not fire on one
+ * noisy sample. floodUpdate() reports a FloodEvent whenever the level
+ * or the flash flag changes.
+ */
+#ifndef FLOOD_H
+#define FLOOD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define FLOOD_WARNING       50          // water %
+#define FLOOD_CRITICAL      70
+#define FLOOD_HYSTERESIS    3
+#define FLOOD_FLASH_RATE    5.0f        // water % per minute
+#define FLOOD_FLASH_CLEAR   3.0f
+#define FLOOD_WINDOW        8           // readings in the slope fit
+#define FLOOD_WINDOW_MS     (10 * 60 * 1000)
+#define FLOOD_MIN_SPAN_MS   30000       // shorter windows give no rate
+#define FLOOD_RISK_ALPHA    0.3f
+
+enum { FLOOD_SAFE, FLOOD_WARN, FLOOD_CRIT };
+
+static const char *floodLevelNames[] = { "safe", "warning", "critical" };
+
+typedef struct {
+    int64_t timeMs[FLOOD_WINDOW];       // ring, oldest at (head - count)
+    float water[FLOOD_WINDOW];
+    int head;
+    int count;
+
+    int primed;
+    int level;
+    int flash;
+    float risk;
+    float riskAvg;
+    float rate;
+    int64_t lastMs;
+} FloodState;
+
+typedef struct {
+    int nodeId;
+    int level;
+    int prevLevel;
+    int flash;
+    float temp, hum;
+    int soil, water;
+    float risk;
+    float riskAvg;
+    float rate;
+    int64_t timeMs;
+} FloodEvent;
+
+/* ---------- RULES ---------- */
+static inline float floodRisk(float hum, int soil, int water) {
+    return water * 0.5f + soil * 0.3f + hum * 0.2f;
+}
+
+static inline int floodLevel(int prev, int water) {
+    if (water >= FLOOD_CRITICAL) return FLOOD_CRIT;
+    if (prev == FLOOD_CRIT && water > FLOOD_CRITICAL - FLOOD_HYSTERESIS) return FLOOD_CRIT;
+    if (water >= FLOOD_WARNING) return FLOOD_WARN;
+    if (prev >= FLOOD_WARN && water > FLOOD_WARNING - FLOOD_HYSTERESIS) return FLOOD_WARN;
+    return FLOOD_SAFE;
+}
+
+/* Least-squares slope of water over the window, per minute; 0 until
+   the window spans FLOOD_MIN_SPAN_MS. */
+static inline float floodSlope(const FloodState *st) {
+    int first = (st->head - st->count + FLOOD_WINDOW) % FLOOD_WINDOW;
+    int64_t t0 = st->timeMs[first];
+    int64_t span = st->timeMs[(st->head - 1 + FLOOD_WINDOW) % FLOOD_WINDOW] - t0;
+    if (st->count < 2 || span < FLOOD_MIN_SPAN_MS) return 0;
+
+    double st1 = 0, sw = 0, stt = 0, stw = 0;
+    for (int k = 0; k < st->count; k++) {
+        int i = (first + k) % FLOOD_WINDOW;
+        double t = (double)(st->timeMs[i] - t0) / 60000.0;
+        st1 += t;
+        sw += st->water[i];
+        stt += t * t;
+        stw += t * st->water[i];
+    }
+    double n = st->count;
+    double den = n * stt - st1 * st1;
+    return den > 0 ? (float)((n * stw - st1 * sw) / den) : 0;
+}
+
+/* ---------- UPDATE ----------
+ * Folds in one reading (timeMs: unix ms). Returns 1 and fills *ev when
+ * the level or flash flag changed. A reading older than the newest
+ * one seen (a late retransmit) counts for the level and risk but not
+ * the slope.
+ */
+static inline int floodUpdate(FloodState *st, int nodeId, int64_t timeMs, float temp,
+                              float hum, int soil, int water, FloodEvent *ev) {
+    st->risk = floodRisk(hum, soil, water);
+    st->riskAvg = st->primed ? st->riskAvg + FLOOD_RISK_ALPHA * (st->risk - st->riskAvg)
+                             : st->risk;
+
+    if (!st->primed || timeMs > st->lastMs) {
+        /* evict readings that fell out of the time window */
+        while (st->count > 0 &&
+               timeMs - st->timeMs[(st->head - st->count + FLOOD_WINDOW) % FLOOD_WINDOW] >
+               FLOOD_WINDOW_MS)
+            st->count--;
+
+        st->timeMs[st->head] = timeMs;
+        st->water[st->head] = (float)water;
+        st->head = (st->head + 1) % FLOOD_WINDOW;
+        if (st->count < FLOOD_WINDOW) st->count++;
+        st->lastMs = timeMs;
+        st->rate = floodSlope(st);
+    }
+
+    int prevLevel = st->level;
+    int prevFlash = st->flash;
+    st->level = floodLevel(prevLevel, water);
+    st->flash = st->rate > (st->flash ? FLOOD_FLASH_CLEAR : FLOOD_FLASH_RATE);
+
+    /* the first reading only reports a node that starts out at risk */
+    int changed = st->primed ? (st->level != prevLevel || st->flash != prevFlash)
+                             : st->level != FLOOD_SAFE;
+    st->primed = 1;
+    if (!changed) return 0;
+
+    ev->nodeId = nodeId;
+    ev->level = st->level;
+    ev->prevLevel = prevLevel;
+    ev->flash = st->flash;
+    ev->temp = temp;
+    ev->hum = hum;
+    ev->soil = soil;
+    ev->water = water;
+    ev->risk = st->risk;
+    ev->riskAvg = st->riskAvg;
+    ev->rate = st->rate;
+    ev->timeMs = timeMs;
+    return 1;
+}
+
+/* ---------- FORMAT ---------- */
+/* key=value text for the log */
+static inline int floodEventText(const FloodEvent *ev, char *out, size_t size) {
+    return snprintf(out, size,
+                    "LEVEL=%s FROM=%s FLASH=%d WATER=%d SOIL=%d HUM=%.2f "
+                    "RISK=%.1f RISK_AVG=%.1f RATE=%.2f",
+                    floodLevelNames[ev->level], floodLevelNames[ev->prevLevel],
+                    ev->flash, ev->water, ev->soil, ev->hum,
+                    ev->risk, ev->riskAvg, ev->rate);
+}
+
+/* one JSON line for alert subscribers */
+static inline int floodEventJson(const FloodEvent *ev, char *out, size_t size) {
+    return snprintf(out, size,
+                    "{\"type\":\"flood\",\"node\":%d,\"level\":\"%s\",\"prevLevel\":\"%s\","
+                    "\"isFlashFlood\":%s,\"water\":%d,\"soil\":%d,\"humidity\":%.2f,"
+                    "\"temperature\":%.2f,\"riskIndex\":%.1f,\"riskAvg\":%.1f,"
+                    "\"changeRate\":%.2f,\"timeMs\":%lld}\n",
+                    ev->nodeId, floodLevelNames[ev->level], floodLevelNames[ev->prevLevel],
+                    ev->flash ? "true" : "false", ev->water, ev->soil, ev->hum, ev->temp,
+                    ev->risk, ev->riskAvg, ev->rate, (long long)ev->timeMs);
+}
+
+#endif
@@ -0,0 +1,282 @@
+/* ================= KEY=VALUE PARSER =================
+ * Single-pass tokenizer for the text formats nodes speak:
+ *
+ *   DATA:TEMP=23.50 HUM=61.00 SOIL=412 WATER=37    v1 datagram
+ *   TEMP:23.5,HUM:61                               Arduino serial line
+ *   TEMP=23.50 HUM=61.00 SOIL=412 WATER=37         shared file
+ *
+ * Fields are separated by spaces, tabs or commas; a key ends at the
+ * first '=' or ':'. Values are parsed in place (no copies, no locale,
+ * no sscanf), numbers with a from_chars-style fast path that falls
+ * back to strtod only for long mantissas or huge exponents.
+ *
+ * Known keys land in a Reading through sensorFields[]; any other key
+ * is kept as a field, so a node can report a new sensor before the
+ * server knows it (see kvExtras()).
+ */
+#ifndef KVPARSE_H
+#define KVPARSE_H
+
+#include "protocol.h"
+#include <float.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KV_MAX_FIELDS 16
+
+typedef struct {
+    const char *key;
+    int keyLen;
+    const char *val;
+    int valLen;
+    double num;
+    int isNum;              // whole value parsed as a number
+} KvField;
+
+/* ---------- NUMBERS ---------- */
+static const double kvPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int kvDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* Parses [+-]digits[.digits][e[+-]digits] at p. Returns the number
+ * of characters used, 0 if there is no number. Exact (correctly
+ * rounded) for up to 15 significant digits and |exponent| <= 22,
+ * which covers every sensor value; anything else goes to strtod.
+ */
+static inline int kvNumber(const char *p, const char *end, double *out) {
+    const char *s = p;
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+    uint64_t mant = 0;
+    int digits = 0, scale = 0, any = 0;
+    while (p < end && *p == '0') { p++; any = 1; }
+    for (; p < end && kvDigit(*p); p++, any = 1) {
+        if (digits < 19) { mant = mant * 10 + (uint64_t)(*p - '0'); digits++; }
+        else scale++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (!digits)
+            for (; p < end && *p == '0'; p++, any = 1) scale--;
+        for (; p < end && kvDigit(*p); p++, any = 1) {
+            if (digits < 19) {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                digits++;
+                scale--;
+            }
+        }
+    }
+    if (!any) return 0;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        int eneg = 0, exp = 0;
+        if (e < end && (*e == '-' || *e == '+')) eneg = *e++ == '-';
+        if (e < end && kvDigit(*e)) {
+            for (; e < end && kvDigit(*e); e++)
+                if (exp < 10000) exp = exp * 10 + (*e - '0');
+            scale += eneg ? -exp : exp;
+            p = e;
+        }
+    }
+
+    if (digits <= 15 && scale >= -22 && scale <= 22) {
+        double v = (double)mant;
+        v = scale < 0 ? v / kvPow10[-scale] : v * kvPow10[scale];
+        *out = neg ? -v : v;
+    } else {
+        char tmp[64];
+        int len = (int)(p - s) < 63 ? (int)(p - s) : 63;
+        memcpy(tmp, s, len);
+        tmp[len] = '\0';
+        *out = strtod(tmp, NULL);
+    }
+    return (int)(p - s);
+}
+
+/* ---------- TOKENIZE ----------
+ * Splits s[0..len) into key/value fields. Words without '=' or ':'
+ * are skipped. Returns the number of fields stored.
+ */
+static inline int kvSep(char c) {
+    return c == ' ' || c == ',' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+}
+
+static inline int kvParse(const char *s, size_t len, KvField *fields, int max) {
+    const char *p = s, *end = s + len;
+    int n = 0;
+
+    while (p < end && n < max) {
+        while (p < end && kvSep(*p)) p++;
+        if (p >= end) break;
+
+        const char *key = p;
+        while (p < end && *p != '=' && *p != ':' && !kvSep(*p)) p++;
+        if (p >= end || kvSep(*p)) continue;
+
+        KvField *f = &fields[n++];
+        f->key = key;
+        f->keyLen = (int)(p - key);
+        f->val = ++p;
+        while (p < end && !kvSep(*p)) p++;
+        f->valLen = (int)(p - f->val);
+        f->isNum = f->valLen > 0 && kvNumber(f->val, p, &f->num) == f->valLen;
+        if (!f->isNum) f->num = 0;
+    }
+    return n;
+}
+
+static inline int kvKeyIs(const KvField *f, const char *key) {
+    return f->key[0] == key[0] && (size_t)f->keyLen == strlen(key) &&
+           memcmp(f->key, key, f->keyLen) == 0;
+}
+
+static inline const KvField *kvFind(const KvField *fields, int n, const char *key) {
+    for (int i = 0; i < n; i++)
+        if (kvKeyIs(&fields[i], key)) return &fields[i];
+    return NULL;
+}
+
+/* ---------- SENSOR FIELDS ----------
+ * One row per Reading member. kvReading() stores every numeric field
+ * it recognises and returns a mask of SENSOR_* bits it set. A value
+ * the member cannot hold (NaN, inf, out of range) counts as missing:
+ * converting it would be undefined behaviour.
+ */
+#define SENSOR_TEMP  0x1
+#define SENSOR_HUM   0x2
+#define SENSOR_SOIL  0x4
+#define SENSOR_WATER 0x8
+#define SENSOR_ALL   (SENSOR_TEMP | SENSOR_HUM | SENSOR_SOIL | SENSOR_WATER)
+
+static const struct {
+    const char *key;
+    int bit;
+    size_t offset;
+    int isFloat;            // else int
+} sensorFields[] = {
+    { "TEMP",  SENSOR_TEMP,  offsetof(Reading, temp),  1 },
+    { "HUM",   SENSOR_HUM,   offsetof(Reading, hum),   1 },
+    { "SOIL",  SENSOR_SOIL,  offsetof(Reading, soil),  0 },
+    { "WATER", SENSOR_WATER, offsetof(Reading, water), 0 },
+};
+
+#define SENSOR_FIELD_COUNT ((int)(sizeof(sensorFields) / sizeof(sensorFields[0])))
+
+static inline int sensorField(const KvField *f) {
+    for (int k = 0; k < SENSOR_FIELD_COUNT; k++)
+        if (kvKeyIs(f, sensorFields[k].key)) return k;
+    return -1;
+}
+
+static inline int kvReading(const KvField *fields, int n, Reading *r) {
+    int mask = 0;
+    for (int i = 0; i < n; i++) {
+        int k = sensorField(&fields[i]);
+        if (k < 0 || !fields[i].isNum) continue;
+
+        double v = fields[i].num;
+        char *slot = (char*)r + sensorFields[k].offset;
+        if (sensorFields[k].isFloat) {
+            if (!(v >= -FLT_MAX && v <= FLT_MAX)) continue;
+            *(float*)slot = (float)v;
+        } else {
+            if (!(v >= INT_MIN && v <= INT_MAX)) continue;
+            *(int*)slot = (int)v;
+        }
+        mask |= sensorFields[k].bit;
+    }
+    return mask;
+}
+
+/* ---------- IDS ----------
+ * Node ids and sequence numbers arrive as parsed doubles. kvNodeId()
+ * accepts only a whole number in 1..INT_MAX and kvSeq() one in
+ * 0..UINT32_MAX, so the cast is defined; anything else ("1e300",
+ * "-5e12", "2.5", NaN) is rejected and the output is left alone.
+ */
+static inline int kvWhole(double v, double lo, double hi) {
+    return v >= lo && v <= hi && v == (double)(int64_t)v;
+}
+
+static inline int kvNodeId(double v, int *id) {
+    if (!kvWhole(v, 1, INT_MAX)) return 0;
+    *id = (int)v;
+    return 1;
+}
+
+static inline int kvSeq(double v, uint32_t *seq) {
+    if (!kvWhole(v, 0, UINT32_MAX)) return 0;
+    *seq = (uint32_t)v;
+    return 1;
+}
+
+/* Keys that describe the message rather than a sensor. */
+static inline int kvMetaKey(const KvField *f) {
+    return kvKeyIs(f, "NODE") || kvKeyIs(f, "SEQ");
+}
+
+/* Appends " KEY=value" for every field that is not a Reading member
+ * or a meta key, so unknown sensors survive into the log. Returns the
+ * length used.
+ */
+static inline int kvExtras(const KvField *fields, int n, char *out, size_t size) {
+    size_t used = 0;
+    if (size) out[0] = '\0';
+    for (int i = 0; i < n; i++) {
+        if (sensorField(&fields[i]) >= 0 || kvMetaKey(&fields[i])) continue;
+        int w = snprintf(out + used, size - used, " %.*s=%.*s",
+                         fields[i].keyLen, fields[i].key,
+                         fields[i].valLen, fields[i].val);
+        if (w < 0 || (size_t)w >= size - used) break;
+        used += (size_t)w;
+    }
+    if (used < size) out[used] = '\0';
+    return (int)used;
+}
+
+/* ---------- MESSAGE VERB ----------
+ * "VERB:rest" -> MSG_* and rest, for the v1 text datagrams. The bare
+ * "EOF" a v1 node sends after each reading is MSG_EOF.
+ */
+#define MSG_UNKNOWN   0
+#define MSG_HEARTBEAT 1
+#define MSG_REGISTER  2
+#define MSG_NODE      3
+#define MSG_DATA      4
+#define MSG_EOF       5
+
+static inline int kvVerb(const char *s, size_t len, const char **rest) {
+    const char *colon = memchr(s, ':', len < 10 ? len : 10);
+    if (!colon) {
+        *rest = s + len;
+        return len == 3 && memcmp(s, "EOF", 3) == 0 ? MSG_EOF : MSG_UNKNOWN;
+    }
+    size_t n = (size_t)(colon - s);
+    *rest = colon + 1;
+
+    switch (n) {
+    case 4:
+        if (memcmp(s, "NODE", 4) == 0) return MSG_NODE;
+        if (memcmp(s, "DATA", 4) == 0) return MSG_DATA;
+        break;
+    case 8:
+        if (memcmp(s, "REGISTER", 8) == 0) return MSG_REGISTER;
+        break;
+    case 9:
+        if (memcmp(s, "HEARTBEAT", 9) == 0) return MSG_HEARTBEAT;
+        break;
+    }
+    return MSG_UNKNOWN;
+}
+
+#endif
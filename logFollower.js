@@ -0,0 +1,317 @@
+/* ================= LOG FOLLOWER =================
+   Tails server_log.txt instead of re-reading it per request. Keeps a
+   byte offset into the file, parses only bytes appended since the
+   last sync, and folds each line into running state:
+
+   - per-node aggregates (nodeStats.js)
+   - the most recent readings, registrations and errors, bounded
+
+   fs.watch triggers a sync as soon as the server appends; every
+   read also syncs first (one fstat when nothing changed), so missed
+   watch events never serve stale data.
+
+   History spans rotation (logrotate.h): the first sync folds in the
+   rotated files server_log.txt.<stamp>-<n>[.gz], oldest first, then
+   follows the active file. The open descriptor survives the rename,
+   so when the server rotates, the rest of the old file is read
+   before switching to the new one. A file truncated in place starts
+   everything over.
+
+   Events, for live streaming:
+     "reading"  every parsed DATA line
+     "node"     a node's summary when its status or last event changes */
+const EventEmitter = require("events");
+const fs = require("fs");
+const path = require("path");
+const zlib = require("zlib");
+const { NodeStats } = require("./nodeStats");
+
+const CHUNK = 1 << 20;
+const RECENT_READINGS = 5000;
+const RECENT_EVENTS = 200;
+const WATCH_DELAY_MS = 20;     // coalesce bursts of appends into one read
+
+/* keep only the newest `max` entries, trimming in batches */
+function pushBounded(list, item, max) {
+  list.push(item);
+  if (list.length > max * 2) list.splice(0, list.length - max);
+}
+
+class LogFollower extends EventEmitter {
+  constructor(file) {
+    super();
+    this.file = file;
+    this.watcher = null;
+    this.fd = null;
+    this.reset();
+  }
+
+  reset() {
+    if (this.fd !== null) fs.closeSync(this.fd);
+    this.fd = null;
+    this.offset = 0;
+    this.loaded = false;          // rotated files not read yet
+    this.partial = Buffer.alloc(0);
+    this.lastNode = null;
+
+    this.stats = new NodeStats();
+    this.sensorData = [];
+    this.registrations = [];
+    this.errors = [];
+  }
+
+  /* fold into the aggregates, announcing status changes */
+  fold(event, node, reading) {
+    const before = node && this.stats.nodes.get(node);
+    const status = before && before.status;
+    const lastEvent = before && before.lastEvent;
+
+    this.stats.fold(event, node, reading);
+
+    if (!node || !this.listenerCount("node")) return;
+    const after = this.stats.nodes.get(node);
+    if (after && (after.status !== status || after.lastEvent !== lastEvent)) {
+      const summary = this.stats.get(node);
+      if (summary) this.emit("node", summary);
+    }
+  }
+
+  /* ---------- PARSE ONE LINE ---------- */
+  parseLine(line) {
+    /* ---------- NODE TRACK ---------- */
+    const nodeMatch = line.match(/Node(\d+)/);
+    if (nodeMatch) {
+      this.lastNode = Number(nodeMatch[1]);
+    }
+    const lastNode = this.lastNode;
+
+    /* ---------- REGISTER ---------- */
+    if (line.includes("REGISTER ->")) {
+      const regMatch = line.match(/\[(.*?)\] (?:Node(\d+) )?REGISTER -> (.*)/);
+      if (regMatch) {
+        const node = regMatch[2] ? Number(regMatch[2]) : lastNode;
+        if (node) {
+          pushBounded(this.registrations, {
+            time: regMatch[1],
+            node,
+            message: regMatch[3],
+            type: regMatch[3].includes("Auto-registered") ? "auto" : "manual"
+          }, RECENT_EVENTS);
+          this.fold("REGISTER", node);
+        }
+      }
+      return;
+    }
+
+    /* ---------- DATA (TEMP + HUM + SOIL + WATER) ---------- */
+    if (line.includes("DATA ->")) {
+      let reading = null;
+      let m = line.match(
+        /\[(.*?)\] Node(\d+) DATA -> TEMP=([\d.]+) HUM=([\d.]+) SOIL=([\d.]+) WATER=([\d.]+)/
+      );
+
+      if (m) {
+        reading = { time: m[1], node: Number(m[2]), temperature: Number(m[3]),
+                    humidity: Number(m[4]), soil: Number(m[5]), water: Number(m[6]) };
+      } else {
+        m = line.match(
+          /\[(.*?)\] DATA -> TEMP=([\d.]+) HUM=([\d.]+) SOIL=([\d.]+) WATER=([\d.]+)/
+        );
+        if (m && lastNode) {
+          reading = { time: m[1], node: lastNode, temperature: Number(m[2]),
+                      humidity: Number(m[3]), soil: Number(m[4]), water: Number(m[5]) };
+        }
+      }
+
+      if (reading) {
+        pushBounded(this.sensorData, reading, RECENT_READINGS);
+        this.fold("DATA", reading.node, reading);
+        this.emit("reading", reading);
+      }
+      return;
+    }
+
+    /* ---------- RECONNECT ---------- */
+    if (line.includes("RECONNECT ->") && lastNode) {
+      this.fold("RECONNECT", lastNode);
+      return;
+    }
+
+    /* ---------- DISCONNECT ---------- */
+    if (line.includes("DISCONNECT ->") && lastNode) {
+      this.fold("DISCONNECT", lastNode);
+      return;
+    }
+
+    /* ---------- UNKNOWN ---------- */
+    if (line.includes("UNKNOWN ->")) {
+      const errMatch = line.match(/\[(.*?)\] Node(\d+) UNKNOWN -> (.*)/);
+      if (errMatch) {
+        pushBounded(this.errors, {
+          time: errMatch[1],
+          node: Number(errMatch[2]),
+          message: errMatch[3]
+        }, RECENT_EVENTS);
+        this.fold("UNKNOWN", Number(errMatch[2]));
+      }
+    }
+  }
+
+  /* ---------- FEED BYTES ----------
+     Only whole lines; a trailing partial line waits for the rest. */
+  feed(buf) {
+    let chunk = this.partial.length ? Buffer.concat([this.partial, buf]) : buf;
+    const end = chunk.lastIndexOf(10);
+    if (end === -1) {
+      this.partial = Buffer.from(chunk);
+      return;
+    }
+    this.partial = Buffer.from(chunk.subarray(end + 1));
+
+    const text = chunk.toString("utf8", 0, end);
+    for (const line of text.split("\n")) {
+      if (line) this.parseLine(line.replace(/\r$/, ""));
+    }
+  }
+
+  /* a finished file: its last line may lack the newline */
+  endOfFile() {
+    if (this.partial.length) this.feed(Buffer.from("\n"));
+  }
+
+  /* ---------- ROTATED FILES ----------
+     Oldest first. A file caught both plain and compressed is read once. */
+  rotated() {
+    const prefix = path.basename(this.file) + ".";
+    let names;
+    try {
+      names = fs.readdirSync(path.dirname(this.file));
+    } catch (err) {
+      return [];
+    }
+    names = names
+      .filter(n => n.startsWith(prefix) && /^\d/.test(n.slice(prefix.length)) &&
+                   !n.endsWith(".tmp"))
+      .sort();
+    const plain = new Set(names);
+    return names
+      .filter(n => !(n.endsWith(".gz") && plain.has(n.slice(0, -3))))
+      .map(n => path.join(path.dirname(this.file), n));
+  }
+
+  loadRotated() {
+    for (const file of this.rotated()) {
+      let data = null;
+      for (const name of file.endsWith(".gz") ? [file] : [file, file + ".gz"]) {
+        try {
+          data = fs.readFileSync(name);     // may be compressed or expired meanwhile
+          if (name.endsWith(".gz")) data = zlib.gunzipSync(data);
+          break;
+        } catch (err) {
+          data = null;
+        }
+      }
+      if (data) {
+        this.feed(data);
+        this.endOfFile();
+      }
+    }
+  }
+
+  /* ---------- READ NEW BYTES ---------- */
+  drain(size) {
+    const buf = Buffer.alloc(Math.min(CHUNK, Math.max(size - this.offset, 0)));
+    while (this.offset < size) {
+      const got = fs.readSync(this.fd, buf, 0, Math.min(buf.length, size - this.offset),
+                              this.offset);
+      if (got <= 0) break;
+      this.offset += got;
+      this.feed(buf.subarray(0, got));
+    }
+  }
+
+  sync() {
+    if (!this.loaded) {
+      this.loaded = true;
+      this.loadRotated();
+    }
+
+    let st = null;
+    try {
+      st = fs.statSync(this.file);
+    } catch (err) {
+      // between rotation and the server's next write
+    }
+
+    if (this.fd !== null) {
+      const held = fs.fstatSync(this.fd);
+      if (held.size < this.offset) {
+        this.reset();
+        return this.sync();
+      }
+      if (!st || st.ino !== held.ino) {
+        this.drain(held.size);
+        this.endOfFile();
+        fs.closeSync(this.fd);
+        this.fd = null;
+        this.offset = 0;
+      }
+    }
+
+    if (this.fd === null) {
+      if (!st) return;
+      try {
+        this.fd = fs.openSync(this.file, "r");
+      } catch (err) {
+        return;
+      }
+    }
+    this.drain(fs.fstatSync(this.fd).size);
+  }
+
+  /* ---------- WATCH ----------
+     Watches the directory so the file may be created or rotated
+     after we start. */
+  watch() {
+    if (this.watcher) return;
+    let pending = null;
+    try {
+      this.watcher = fs.watch(path.dirname(this.file), (type, name) => {
+        if (name && name !== path.basename(this.file)) return;
+        if (pending) return;
+        pending = setTimeout(() => { pending = null; this.sync(); }, WATCH_DELAY_MS);
+      });
+      this.watcher.on("error", () => { this.watcher = null; });
+    } catch (err) {
+      this.watcher = null;      // directory missing: reads still sync
+    }
+  }
+
+  /* ---------- QUERIES ---------- */
+  latest(limit = 50) {
+    this.sync();
+    return this.sensorData.slice(-limit);
+  }
+
+  latestRegistrations(limit = 20) {
+    this.sync();
+    return this.registrations.slice(-limit).reverse();
+  }
+
+  latestErrors(limit = 20) {
+    this.sync();
+    return this.errors.slice(-limit).reverse();
+  }
+
+  nodeStats() {
+    this.sync();
+    return this.stats.list();
+  }
+
+  overview() {
+    this.sync();
+    return this.stats.overview();
+  }
+}
+
+module.exports = { LogFollower };
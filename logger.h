@@ -0,0 +1,272 @@
+/* ================= ASYNC LOGGER =================
+ * logToFile() never touches the disk. It claims a slot in a bounded
+ * lock-free MPSC ring (per-slot sequence numbers) and returns; a
+ * single writer thread drains the ring, keeps server_log.txt open,
+ * formats timestamps once per second and writes whole batches.
+ *
+ * The file is flushed after every batch and fsync'd every
+ * logFsyncMs. When the ring is full the entry is dropped and
+ * logDropped counts it, so a slow disk never stalls ingestion.
+ *
+ * With logSegments() the same writer also appends every entry as a
+ * fixed-width record to the binary segment log (segment.h), and
+ * expires old segments under the same logKeepFiles / logKeepDays
+ * limits as the rotated text files.
+ *
+ * The text file is rotated by size and age and old files are
+ * compressed and expired in the background (logrotate.h).
+ */
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "platform.h"
+#include "segment.h"
+#include "logrotate.h"
+#include "metrics.h"
+#include <stdatomic.h>
+#include <time.h>
+
+#define LOG_FILE       "server_log.txt"
+#define LOG_RING_SIZE  4096            // power of two
+#define LOG_EVENT_MAX  16
+#define LOG_DATA_MAX   512
+#define LOG_IDLE_MS    5               // writer nap when ring is empty
+#define LOG_FSYNC_MS   1000
+
+typedef struct {
+    time_t when;
+    int nodeId;
+    char event[LOG_EVENT_MAX];
+    char data[LOG_DATA_MAX];
+    int hasReading;
+    Reading reading;        // numeric copy of a DATA line, for segments
+} LogEntry;
+
+typedef struct {
+    atomic_size_t seq;
+    LogEntry entry;
+} LogCell;
+
+static LogCell logRing[LOG_RING_SIZE];
+static atomic_size_t logHead;          // next slot producers claim
+static size_t logTail;                 // writer thread only
+static atomic_ulong logDropped;        // backpressure counter
+static int logFsyncMs = LOG_FSYNC_MS;
+static const char *logPath = LOG_FILE;
+static const char *logSegDir;          // NULL = no binary segments
+static long logSegBytes = SEG_MAX_BYTES;
+
+/* ---------- GET TIMESTAMP ---------- */
+static inline void getTimestamp(time_t when, char *timeBuf, int size) {
+    struct tm t;
+    localTime(when, &t);
+    strftime(timeBuf, size, "%Y-%m-%d %H:%M:%S", &t);
+}
+
+/* ---------- LOG TO FILE ----------
+ * Safe from any thread. `when` is the event time (readings batched
+ * by a node keep their own). Returns 0 if the entry was dropped.
+ */
+static inline int logPush(time_t when, int nodeId, const char *eventType,
+                          const char *data, const Reading *r) {
+    size_t pos = atomic_load_explicit(&logHead, memory_order_relaxed);
+    LogCell *cell;
+
+    while (1) {
+        cell = &logRing[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&logHead, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&logDropped, 1, memory_order_relaxed);
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&logHead, memory_order_relaxed);
+        }
+    }
+
+    cell->entry.when = when;
+    cell->entry.nodeId = nodeId;
+    snprintf(cell->entry.event, LOG_EVENT_MAX, "%s", eventType);
+    snprintf(cell->entry.data, LOG_DATA_MAX, "%s", data);
+    cell->entry.hasReading = r != NULL;
+    if (r) cell->entry.reading = *r;
+
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return 1;
+}
+
+static inline int logToFileAt(time_t when, int nodeId,
+                              const char *eventType, const char *data) {
+    return logPush(when, nodeId, eventType, data, NULL);
+}
+
+/* A DATA line plus its numeric reading; r->timeMs is the event time. */
+static inline int logReadingEntry(int nodeId, const char *data, const Reading *r) {
+    return logPush((time_t)(r->timeMs / 1000), nodeId, "DATA", data, r);
+}
+
+static inline int logToFile(int nodeId, const char *eventType, const char *data) {
+    return logToFileAt(time(NULL), nodeId, eventType, data);
+}
+
+/* ---------- TAKE ONE ENTRY (writer) ---------- */
+static inline LogEntry *logPeek(void) {
+    LogCell *cell = &logRing[logTail & (LOG_RING_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    return seq == logTail + 1 ? &cell->entry : NULL;
+}
+
+static inline void logRelease(void) {
+    LogCell *cell = &logRing[logTail & (LOG_RING_SIZE - 1)];
+    atomic_store_explicit(&cell->seq, logTail + LOG_RING_SIZE, memory_order_release);
+    logTail++;
+}
+
+/* ---------- SEGMENT RECORD ---------- */
+static inline void logToSegment(SegWriter *seg, const LogEntry *e) {
+    SegRecord r;
+    r.timeMs = e->hasReading ? e->reading.timeMs : (uint64_t)e->when * 1000;
+    r.nodeId = (uint32_t)e->nodeId;
+    r.event = e->hasReading ? SEG_DATA : segEventCode(e->event);
+    memset(&r.reading, 0, sizeof(r.reading));
+    if (e->hasReading) r.reading = e->reading;
+    segAppend(seg, &r);
+}
+
+/* ---------- WRITER THREAD ---------- */
+static THREAD_FUNC(logWriter) {
+    (void)arg;
+    static char fileBuf[1 << 16];
+    static SegWriter seg;
+    FILE *fp = NULL;
+    Metrics *m = metricsRegister("log");
+
+    int segOn = logSegDir && segWriterInit(&seg, logSegDir, logSegBytes) == 0;
+    if (logSegDir && !segOn)
+        printf("⚠️ Cannot create segment directory %s\n", logSegDir);
+
+    time_t cachedSec = 0;
+    char timeBuf[64] = "";
+    unsigned long reportedDrops = 0;
+    uint64_t lastSync = nowMs();
+    int dirty = 0;
+    time_t openedAt = 0, rotateAfter = 0;
+    uint64_t lastRetain = 0;
+
+    while (1) {
+        if (!fp) {
+            fp = fopen(logPath, "a");
+            if (!fp) { sleepMs(1000); continue; }
+            setvbuf(fp, fileBuf, _IOFBF, sizeof(fileBuf));
+            openedAt = time(NULL);
+        }
+
+        int wrote = 0;
+        LogEntry *e;
+        uint64_t t = monoNs();
+        while (wrote < LOG_RING_SIZE && (e = logPeek()) != NULL) {
+            if (e->when != cachedSec) {
+                cachedSec = e->when;
+                getTimestamp(cachedSec, timeBuf, sizeof(timeBuf));
+            }
+            fprintf(fp, "[%s] Node%d %s -> %s\n",
+                    timeBuf, e->nodeId, e->event, e->data);
+            if (segOn) logToSegment(&seg, e);
+            logRelease();
+            wrote++;
+        }
+
+        if (wrote) {
+            fflush(fp);
+            if (segOn) segFlush(&seg);
+            dirty = 1;
+            histSince(m, H_LOG_WRITE, t);
+            counterAdd(m, C_LOG_LINES, (uint64_t)wrote);
+        }
+
+        uint64_t now = nowMs();
+        if (dirty && now - lastSync >= (uint64_t)logFsyncMs) {
+            t = monoNs();
+            fileSync(fp);
+            if (segOn && seg.dat) {
+                fileSync(seg.dat);
+                fileSync(seg.idx);
+            }
+            histSince(m, H_LOG_FSYNC, t);
+            lastSync = now;
+            dirty = 0;
+        }
+
+        /* ---------- ROTATE ---------- */
+        if (time(NULL) >= rotateAfter && logRotateDue(fp, openedAt)) {
+            fileSync(fp);
+            fclose(fp);
+            fp = NULL;
+            dirty = 0;
+            if (logRotateFile(logPath) != 0) {
+                printf("⚠️ Cannot rotate %s, retrying in %ds\n", logPath, LOG_RETRY_SEC);
+                rotateAfter = time(NULL) + LOG_RETRY_SEC;
+            }
+            continue;
+        }
+
+        /* ---------- SEGMENT RETENTION ----------
+           Here rather than in logMaintainer: only this thread knows
+           which segment is open. */
+        if (segOn && (!lastRetain || now - lastRetain >= LOG_MAINT_MS)) {
+            int removed = segRetain(&seg, logKeepFiles, logKeepDays);
+            if (removed) printf("🗑️ Removed %d old segment(s) from %s\n", removed, logSegDir);
+            lastRetain = now;
+        }
+
+        unsigned long drops = atomic_load(&logDropped);
+        if (drops != reportedDrops) {
+            printf("⚠️ Log buffer full, %lu entries dropped so far\n", drops);
+            reportedDrops = drops;
+        }
+
+        if (!wrote) sleepMs(LOG_IDLE_MS);
+    }
+    THREAD_RETURN;
+}
+
+/* ---------- BINARY SEGMENTS ----------
+ * Call before logInit(). maxBytes <= 0 keeps the default size.
+ */
+static inline void logSegments(const char *dir, long maxBytes) {
+    logSegDir = dir;
+    if (maxBytes > 0) logSegBytes = maxBytes;
+}
+
+/* ---------- ROTATION / RETENTION ----------
+ * Call before logInit(). Negative values keep the defaults; 0 turns
+ * that limit off. keepFiles / keepDays also bound the segments.
+ */
+static inline void logRotation(long maxBytes, long maxSec, int keepFiles, int keepDays) {
+    if (maxBytes >= 0) logRotateBytes = maxBytes;
+    if (maxSec >= 0) logRotateSec = maxSec;
+    if (keepFiles >= 0) logKeepFiles = keepFiles;
+    if (keepDays >= 0) logKeepDays = keepDays;
+}
+
+/* ---------- START LOGGER ---------- */
+static inline int logInit(const char *path, int fsyncMs) {
+    for (size_t i = 0; i < LOG_RING_SIZE; i++)
+        atomic_init(&logRing[i].seq, i);
+    atomic_init(&logHead, 0);
+    atomic_init(&logDropped, 0);
+    logTail = 0;
+
+    if (path) logPath = path;
+    if (fsyncMs >= 0) logFsyncMs = fsyncMs;
+    atomic_init(&logRotated, 0);
+    if (startThread(logMaintainer, (void*)logPath) != 0) return -1;
+    return startThread(logWriter, NULL);
+}
+
+#endif
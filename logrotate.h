@@ -0,0 +1,206 @@
+/* ================= LOG ROTATION =================
+ * Keeps server_log.txt bounded. After each batch the logger's writer
+ * thread asks logRotateDue(); once the active file is larger than
+ * logRotateBytes or has been open for logRotateSec it is synced,
+ * closed and renamed to
+ *
+ *   server_log.txt.<YYYYmmdd-HHMMSS>-<nnn>
+ *
+ * and a fresh file is opened. nnn separates rotations within one
+ * second, so names sort in rotation order. rename() is atomic: a
+ * reader sees either the old file or the new one under the active
+ * name.
+ *
+ * A maintenance thread compresses rotated files to .gz (build with
+ * -DLOG_GZIP -lz; without it they stay plain text) through a .tmp
+ * file and a rename, then deletes the oldest beyond logKeepFiles and
+ * any older than logKeepDays. It works from a directory listing, so
+ * files left behind by a crash are handled on the next start.
+ */
+#ifndef LOGROTATE_H
+#define LOGROTATE_H
+
+#include "platform.h"
+#include "segment.h"
+#include <ctype.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef LOG_GZIP
+#include <zlib.h>
+#endif
+
+#define LOG_ROTATE_BYTES  (16L * 1024 * 1024)
+#define LOG_ROTATE_SEC    (24L * 60 * 60)
+#define LOG_KEEP_FILES    14
+#define LOG_KEEP_DAYS     0             // 0 = no age limit
+#define LOG_MAINT_MS      60000         // retention check when idle
+#define LOG_RETRY_SEC     60            // after a failed rename
+
+static long logRotateBytes = LOG_ROTATE_BYTES;  // 0 = never by size
+static long logRotateSec = LOG_ROTATE_SEC;      // 0 = never by age
+static int logKeepFiles = LOG_KEEP_FILES;       // 0 = keep all
+static int logKeepDays = LOG_KEEP_DAYS;
+static atomic_int logRotated;                   // wakes maintenance
+
+/* ---------- PATH HELPERS ---------- */
+static inline int fileExists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/* "dir/name" -> dir ("." if none) and a pointer to name */
+static inline const char *logSplitPath(const char *path, char *dir, size_t size) {
+    const char *slash = strrchr(path, '/');
+#ifdef _WIN32
+    const char *back = strrchr(path, '\\');
+    if (back && (!slash || back > slash)) slash = back;
+#endif
+    if (!slash) {
+        snprintf(dir, size, ".");
+        return path;
+    }
+    snprintf(dir, size, "%.*s", (int)(slash - path), path);
+    return slash + 1;
+}
+
+/* ---------- ROTATE ACTIVE FILE ---------- */
+static inline int logRotateDue(FILE *fp, time_t openedAt) {
+    long size = ftell(fp);
+    if (size <= 0) return 0;
+    if (logRotateBytes > 0 && size >= logRotateBytes) return 1;
+    return logRotateSec > 0 && time(NULL) - openedAt >= logRotateSec;
+}
+
+/* Renames the (closed) active file aside. Returns 0 on success. */
+static inline int logRotateFile(const char *path) {
+    char stamp[32], target[SEG_PATH_MAX + 48], gz[SEG_PATH_MAX + 56];
+    struct tm t;
+
+    localTime(time(NULL), &t);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &t);
+    for (int n = 0; ; n++) {
+        snprintf(target, sizeof(target), "%s.%s-%03d", path, stamp, n);
+        snprintf(gz, sizeof(gz), "%s.gz", target);
+        if (!fileExists(target) && !fileExists(gz)) break;
+    }
+
+    if (rename(path, target) != 0) return -1;
+    atomic_store(&logRotated, 1);
+    return 0;
+}
+
+/* ---------- COMPRESS ONE FILE ---------- */
+static inline int logCompress(const char *path) {
+#ifdef LOG_GZIP
+    static char buf[1 << 16];
+    char tmp[SEG_PATH_MAX + 64], out[SEG_PATH_MAX + 64];
+    snprintf(out, sizeof(out), "%s.gz", path);
+    snprintf(tmp, sizeof(tmp), "%s.gz.tmp", path);
+
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+    gzFile gz = gzopen(tmp, "wb6");
+    if (!gz) {
+        fclose(in);
+        return -1;
+    }
+
+    int ok = 1;
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (gzwrite(gz, buf, (unsigned)n) != (int)n) {
+            ok = 0;
+            break;
+        }
+    }
+    if (ferror(in)) ok = 0;
+    fclose(in);
+    if (gzclose(gz) != Z_OK) ok = 0;
+
+    /* on disk before the rename makes it visible */
+    FILE *fp = ok ? fopen(tmp, "ab") : NULL;
+    if (fp) {
+        fileSync(fp);
+        fclose(fp);
+    }
+#ifdef _WIN32
+    if (ok) remove(out);     // rename() does not replace on Windows
+#endif
+    if (!ok || !fp || rename(tmp, out) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    remove(path);
+    return 0;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+/* ---------- MAINTENANCE PASS ----------
+ * Compress, then apply retention to what is left. Only names of the
+ * form <base>.<digits>... count as rotated files.
+ */
+static inline void logMaintain(const char *path) {
+    char dir[SEG_PATH_MAX], prefix[SEG_PATH_MAX];
+    const char *base = logSplitPath(path, dir, sizeof(dir));
+    snprintf(prefix, sizeof(prefix), "%s.", base);
+    size_t skip = strlen(dir) + 1 + strlen(prefix);
+
+    int n;
+    char **files = listFiles(dir, prefix, "", &n);
+    for (int i = 0; i < n; i++) {
+        const char *name = files[i] + skip;
+        size_t len = strlen(name);
+        if (!isdigit((unsigned char)name[0])) continue;
+        if (len > 4 && strcmp(name + len - 4, ".tmp") == 0)
+            remove(files[i]);               // interrupted compression
+        else if (len < 3 || strcmp(name + len - 3, ".gz") != 0)
+            logCompress(files[i]);
+    }
+    listFree(files, n);
+
+    files = listFiles(dir, prefix, "", &n);
+    int rotated = 0;
+    for (int i = 0; i < n; i++) {
+        const char *name = files[i] + skip;
+        size_t len = strlen(name);
+        if (isdigit((unsigned char)name[0]) &&
+            !(len > 4 && strcmp(name + len - 4, ".tmp") == 0))
+            files[rotated++] = files[i];
+        else
+            free(files[i]);
+    }
+
+    time_t cutoff = logKeepDays > 0 ? time(NULL) - (time_t)logKeepDays * 86400 : 0;
+    for (int i = 0; i < rotated; i++) {
+        struct stat st;
+        int excess = logKeepFiles > 0 && rotated - i > logKeepFiles;
+        int expired = cutoff && stat(files[i], &st) == 0 && st.st_mtime < cutoff;
+        if (excess || expired) {
+            if (remove(files[i]) == 0)
+                printf("🗑️ Removed old log %s\n", files[i]);
+        }
+    }
+    listFree(files, rotated);
+}
+
+/* ---------- MAINTENANCE THREAD ---------- */
+static THREAD_FUNC(logMaintainer) {
+    const char *path = (const char*)arg;
+    uint64_t last = 0;
+
+    while (1) {
+        uint64_t now = nowMs();
+        if (atomic_exchange(&logRotated, 0) || !last || now - last >= LOG_MAINT_MS) {
+            logMaintain(path);
+            last = now;
+        }
+        sleepMs(100);
+    }
+    THREAD_RETURN;
+}
+
+#endif
@@ -0,0 +1,289 @@
+/* ================= METRICS =================
+ * Hot-path counters and latency histograms for the collector.
+ *
+ * Every thread that records gets its own Metrics block
+ * (metricsRegister), so recording is a relaxed load and store on
+ * memory no other thread writes: no locked instructions, no shared
+ * cache lines. A scrape walks all blocks and sums them.
+ *
+ * Histograms are HDR-style log-linear: values below 8 ns get a
+ * bucket each, above that every power of two is split into 8, so a
+ * bucket is never wider than 12.5% of its value. They are kept in ns
+ * and exported in seconds.
+ *
+ * The stats socket answers any request on a loopback TCP port with
+ * the Prometheus text format (an HTTP/1.0 reply, so both curl and a
+ * Prometheus scrape job work).
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "platform.h"
+#include "query.h"
+#include <stdatomic.h>
+
+#define STATS_PORT      8891
+#define STATS_IO_MS     2000            // per scrape, then the connection is dropped
+#define METRICS_MAX     (64 + 8)        // workers + logger + spare
+#define HIST_SUB_BITS   3
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_MAX_SHIFT  37              // top bucket starts near 2^40 ns (18 min)
+#define HIST_BUCKETS    ((HIST_MAX_SHIFT + 2) * HIST_SUB)
+
+/* ---------- WHAT IS MEASURED ----------
+ * One row per metric; the enums index the tables.
+ */
+typedef enum {
+    C_PACKETS,
+    C_BYTES,
+    C_RECV_CALLS,
+    C_FRAMES_V2,
+    C_MESSAGES_V1,
+    C_PARSE_ERRORS,
+    C_READINGS,
+    C_DUPLICATES,
+    C_ACKS,
+    C_LOG_LINES,
+    C_ALERTS,
+    C_COUNT
+} CounterId;
+
+static const struct {
+    const char *name;
+    const char *help;
+} counterInfo[C_COUNT] = {
+    { "sensor_packets_received_total",   "Datagrams received" },
+    { "sensor_bytes_received_total",     "Datagram payload bytes received" },
+    { "sensor_recv_calls_total",         "recvmmsg/recvfrom rounds that returned data" },
+    { "sensor_frames_v2_total",          "Binary v2 frames handled" },
+    { "sensor_messages_v1_total",        "Text v1 datagrams handled" },
+    { "sensor_parse_errors_total",       "Malformed v2 frames, unknown or incomplete v1 messages" },
+    { "sensor_readings_stored_total",    "Readings logged and stored" },
+    { "sensor_duplicates_dropped_total", "Readings dropped as sequence duplicates" },
+    { "sensor_acks_sent_total",          "Selective ACK datagrams sent" },
+    { "sensor_log_lines_written_total",  "Lines written to the text log" },
+    { "sensor_flood_alerts_total",       "Flood level / flash flood changes raised" },
+};
+
+typedef enum {
+    H_RECV,
+    H_PARSE,
+    H_REGISTRY,
+    H_REGISTER_LOCK,
+    H_LOG_WRITE,
+    H_LOG_FSYNC,
+    H_ALERT,
+    H_COUNT
+} HistId;
+
+static const struct {
+    const char *name;
+    const char *help;
+} histInfo[H_COUNT] = {
+    { "sensor_recv_seconds",               "One receive round (batch syscall)" },
+    { "sensor_parse_seconds",              "Decoding one datagram" },
+    { "sensor_registry_lookup_seconds",    "Registry lookup for an incoming datagram" },
+    { "sensor_register_lock_hold_seconds", "Shard lock hold time in registerClient" },
+    { "sensor_log_write_seconds",          "Writing and flushing one batch of log lines" },
+    { "sensor_log_fsync_seconds",          "fsync of the log and segment files" },
+    { "sensor_alert_raise_seconds",        "Logging and pushing one flood alert" },
+};
+
+typedef struct {
+    _Atomic uint64_t count[HIST_BUCKETS];
+    _Atomic uint64_t sumNs;
+} Histogram;
+
+typedef struct {
+    char thread[24];
+    _Atomic uint64_t counters[C_COUNT];
+    Histogram hist[H_COUNT];
+} Metrics;
+
+static _Atomic(Metrics*) metricsList[METRICS_MAX];     // NULL until filled in
+static atomic_int metricsCount;
+
+/* ---------- CLOCK ---------- */
+static inline uint64_t monoNs(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER c;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&c);
+    return (uint64_t)((double)c.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* ---------- REGISTER A THREAD ----------
+ * Returns a zeroed block owned by the caller, NULL when out of slots
+ * (recording into NULL is a no-op).
+ */
+static inline Metrics *metricsRegister(const char *thread) {
+    int i = atomic_load(&metricsCount);
+    if (i >= METRICS_MAX) return NULL;
+
+    Metrics *m = calloc(1, sizeof(Metrics));
+    if (!m) return NULL;
+    snprintf(m->thread, sizeof(m->thread), "%s", thread);
+
+    while (!atomic_compare_exchange_weak(&metricsCount, &i, i + 1))
+        if (i >= METRICS_MAX) { free(m); return NULL; }
+    atomic_store_explicit(&metricsList[i], m, memory_order_release);
+    return m;
+}
+
+/* ---------- RECORD (owning thread only) ---------- */
+static inline void bumpU64(_Atomic uint64_t *p, uint64_t v) {
+    atomic_store_explicit(p, atomic_load_explicit(p, memory_order_relaxed) + v,
+                          memory_order_relaxed);
+}
+
+static inline void counterAdd(Metrics *m, CounterId id, uint64_t v) {
+    if (m) bumpU64(&m->counters[id], v);
+}
+
+static inline int histBucket(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int shift = 63 - __builtin_clzll(v) - HIST_SUB_BITS;
+    if (shift > HIST_MAX_SHIFT) return HIST_BUCKETS - 1;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+/* midpoint of a bucket, in ns */
+static inline double histValue(int b) {
+    if (b < HIST_SUB) return b;
+    int shift = b / HIST_SUB - 1;
+    double lo = (double)((uint64_t)(HIST_SUB + b % HIST_SUB) << shift);
+    return lo + (double)(1ULL << shift) / 2;
+}
+
+static inline void histRecord(Metrics *m, HistId id, uint64_t ns) {
+    if (!m) return;
+    bumpU64(&m->hist[id].count[histBucket(ns)], 1);
+    bumpU64(&m->hist[id].sumNs, ns);
+}
+
+/* times a block: uint64_t t = monoNs(); ... histSince(m, H_X, t); */
+static inline void histSince(Metrics *m, HistId id, uint64_t startNs) {
+    if (m) histRecord(m, id, monoNs() - startNs);
+}
+
+/* ---------- AGGREGATE ---------- */
+static inline uint64_t metricsTotal(CounterId id) {
+    uint64_t sum = 0;
+    int n = atomic_load(&metricsCount);
+    for (int i = 0; i < n; i++) {
+        Metrics *m = atomic_load_explicit(&metricsList[i], memory_order_acquire);
+        if (m) sum += atomic_load_explicit(&m->counters[id], memory_order_relaxed);
+    }
+    return sum;
+}
+
+/* ---------- PROMETHEUS TEXT ----------
+ * Counters summed over threads, plus packets per thread to show how
+ * evenly the kernel spreads the shards. Histogram `le` bounds run
+ * 1-2-5 from 100 ns to 10 s; a bucket counts toward a bound when its
+ * midpoint is at or below it.
+ */
+static inline void metricsRender(StrBuf *out) {
+    int n = atomic_load(&metricsCount);
+
+    for (int c = 0; c < C_COUNT; c++) {
+        sbPrintf(out, "# HELP %s %s\n# TYPE %s counter\n",
+                 counterInfo[c].name, counterInfo[c].help, counterInfo[c].name);
+        sbPrintf(out, "%s %llu\n", counterInfo[c].name,
+                 (unsigned long long)metricsTotal((CounterId)c));
+    }
+
+    sbPrintf(out, "# HELP sensor_thread_packets_total Datagrams received per thread\n"
+                  "# TYPE sensor_thread_packets_total counter\n");
+    for (int i = 0; i < n; i++) {
+        Metrics *m = atomic_load_explicit(&metricsList[i], memory_order_acquire);
+        if (!m || m->thread[0] != 'w') continue;
+        sbPrintf(out, "sensor_thread_packets_total{thread=\"%s\"} %llu\n",
+                 m->thread, (unsigned long long)atomic_load(&m->counters[C_PACKETS]));
+    }
+
+    static uint64_t merged[HIST_BUCKETS];   // only the stats thread renders
+    for (int h = 0; h < H_COUNT; h++) {
+        uint64_t sumNs = 0, total = 0;
+        memset(merged, 0, sizeof(merged));
+        for (int i = 0; i < n; i++) {
+            Metrics *m = atomic_load_explicit(&metricsList[i], memory_order_acquire);
+            if (!m) continue;
+            const Histogram *hg = &m->hist[h];
+            for (int b = 0; b < HIST_BUCKETS; b++)
+                merged[b] += atomic_load_explicit(&hg->count[b], memory_order_relaxed);
+            sumNs += atomic_load_explicit(&hg->sumNs, memory_order_relaxed);
+        }
+
+        const char *name = histInfo[h].name;
+        sbPrintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, histInfo[h].help, name);
+
+        int b = 0;
+        for (double decade = 100; decade <= 1e10; decade *= 10) {
+            static const double steps[] = { 1, 2, 5 };
+            for (int k = 0; k < 3 && decade * steps[k] <= 1e10; k++) {
+                double le = decade * steps[k];
+                while (b < HIST_BUCKETS && histValue(b) <= le) total += merged[b++];
+                sbPrintf(out, "%s_bucket{le=\"%g\"} %llu\n", name, le / 1e9,
+                         (unsigned long long)total);
+            }
+        }
+        while (b < HIST_BUCKETS) total += merged[b++];
+        sbPrintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)total);
+        sbPrintf(out, "%s_sum %.9f\n%s_count %llu\n", name, sumNs / 1e9,
+                 name, (unsigned long long)total);
+    }
+}
+
+/* ---------- STATS SOCKET ----------
+ * The callback renders the whole page (metricsRender plus whatever
+ * gauges the caller owns).
+ */
+typedef void (*StatsRender)(StrBuf *out);
+
+static StatsRender statsRender;
+
+static THREAD_FUNC(statsListen) {
+    sock_t ls = (sock_t)(intptr_t)arg;
+    StrBuf body = {0};
+    char head[160], req[1024];
+
+    while (1) {
+        sock_t s = accept(ls, NULL, NULL);
+        if (s == INVALID_SOCK) { sleepMs(100); continue; }
+
+        /* the request itself does not matter; read what was sent. One
+           thread serves every scrape, so a client that connects and
+           says nothing only holds it for STATS_IO_MS */
+        sockTimeouts(s, STATS_IO_MS);
+        recv(s, req, sizeof(req), 0);
+
+        body.len = 0;
+        statsRender(&body);
+        int n = snprintf(head, sizeof(head),
+                         "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %lu\r\n\r\n", (unsigned long)body.len);
+        if (sendAll(s, head, (size_t)n) == 0 && body.len)
+            sendAll(s, body.buf, body.len);
+        sockClose(s);
+    }
+    THREAD_RETURN;
+}
+
+/* Returns 0 once the listener is running. */
+static inline int statsStart(unsigned short port, StatsRender render) {
+    sock_t ls = tcpListen(port, 1);
+    if (ls == INVALID_SOCK) return -1;
+
+    statsRender = render;
+    return startThread(statsListen, (void*)(intptr_t)ls);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/* ================= RUNNING NODE STATISTICS =================
+   Per-node aggregates updated one event at a time, so a log source
+   only has to fold in what is new. Output matches the shapes
+   /api/nodes and /api/overview have always returned. */
+
+function pad(n) {
+  return String(n).padStart(2, "0");
+}
+
+/* "YYYY-MM-DD HH:MM:SS" in local time, like the server's log lines */
+function formatTime(ms) {
+  const d = new Date(ms);
+  return `${d.getFullYear()}-${pad(d.getMonth() + 1)}-${pad(d.getDate())} ` +
+         `${pad(d.getHours())}:${pad(d.getMinutes())}:${pad(d.getSeconds())}`;
+}
+
+class NodeStats {
+  constructor() {
+    this.reset();
+  }
+
+  reset() {
+    this.nodes = new Map();
+    this.totalReadings = 0;
+    this.totalRegistrations = 0;
+    this.totalErrors = 0;
+  }
+
+  /* event: DATA / REGISTER / RECONNECT / DISCONNECT / UNKNOWN, plus
+     POLICY and ALERT, which are records only and leave the stats alone.
+     For DATA, d = { time, temperature, humidity, soil, water } where
+     time is unix ms or an already formatted string. */
+  fold(event, node, d) {
+    if (event === "POLICY" || event === "ALERT") return;
+    if (event === "UNKNOWN") {
+      this.totalErrors++;
+      return;
+    }
+    if (event === "REGISTER") this.totalRegistrations++;
+    if (!node) return;
+
+    let n = this.nodes.get(node);
+    if (!n) {
+      n = {
+        id: node, totalReadings: 0, first: null, last: null,
+        sumTemp: 0, sumHum: 0, sumSoil: 0, sumWater: 0,
+        minTemp: Infinity, maxTemp: -Infinity, minHum: Infinity, maxHum: -Infinity,
+        minSoil: Infinity, maxSoil: -Infinity, minWater: Infinity, maxWater: -Infinity,
+        registrations: 0, status: "offline", lastEvent: "UNKNOWN"
+      };
+      this.nodes.set(node, n);
+    }
+
+    switch (event) {
+    case "REGISTER":
+      n.registrations++;
+      break;
+    case "RECONNECT":
+      n.status = "online";
+      n.lastEvent = "RECONNECT";
+      break;
+    case "DISCONNECT":
+      n.status = "offline";
+      n.lastEvent = "DISCONNECT";
+      break;
+    case "DATA":
+      if (!n.totalReadings) n.first = d.time;
+      n.last = d.time;
+      n.totalReadings++;
+      this.totalReadings++;
+      n.sumTemp += d.temperature;
+      n.sumHum += d.humidity;
+      n.sumSoil += d.soil;
+      n.sumWater += d.water;
+      n.minTemp = Math.min(n.minTemp, d.temperature);
+      n.maxTemp = Math.max(n.maxTemp, d.temperature);
+      n.minHum = Math.min(n.minHum, d.humidity);
+      n.maxHum = Math.max(n.maxHum, d.humidity);
+      n.minSoil = Math.min(n.minSoil, d.soil);
+      n.maxSoil = Math.max(n.maxSoil, d.soil);
+      n.minWater = Math.min(n.minWater, d.water);
+      n.maxWater = Math.max(n.maxWater, d.water);
+      n.status = "online";
+      n.lastEvent = "DATA";
+      break;
+    }
+  }
+
+  summary(n) {
+    const fix = v => Number(v.toFixed(2));
+    const time = t => typeof t === "number" ? formatTime(t) : t;
+
+    return {
+      id: n.id,
+      totalReadings: n.totalReadings,
+      lastSeen: time(n.last),
+      firstSeen: time(n.first),
+      avgTemp: fix(n.sumTemp / n.totalReadings),
+      avgHum: fix(n.sumHum / n.totalReadings),
+      avgSoil: fix(n.sumSoil / n.totalReadings),
+      avgWater: fix(n.sumWater / n.totalReadings),
+      minTemp: n.minTemp, maxTemp: n.maxTemp,
+      minHum: n.minHum, maxHum: n.maxHum,
+      minSoil: n.minSoil, maxSoil: n.maxSoil,
+      minWater: n.minWater, maxWater: n.maxWater,
+      registrations: n.registrations,
+      status: n.status,
+      lastEvent: n.lastEvent
+    };
+  }
+
+  /* one node's entry, null until it has sent a reading */
+  get(node) {
+    const n = this.nodes.get(node);
+    return n && n.totalReadings > 0 ? this.summary(n) : null;
+  }
+
+  list() {
+    return [...this.nodes.values()]
+      .filter(n => n.totalReadings > 0)
+      .sort((a, b) => a.id - b.id)
+      .map(n => this.summary(n));
+  }
+
+  overview() {
+    const nodes = this.list();
+    return {
+      totalNodes: nodes.length,
+      totalReadings: this.totalReadings,
+      totalRegistrations: this.totalRegistrations,
+      totalErrors: this.totalErrors,
+      activeNodes: nodes.filter(n => n.status === "online").length,
+      avgTemperature: nodes.length > 0
+        ? (nodes.reduce((sum, n) => sum + n.avgTemp, 0) / nodes.length).toFixed(2)
+        : 0,
+      avgHumidity: nodes.length > 0
+        ? (nodes.reduce((sum, n) => sum + n.avgHum, 0) / nodes.length).toFixed(2)
+        : 0
+    };
+  }
+}
+
+module.exports = { NodeStats, formatTime };
@@ -0,0 +1,480 @@
+/* ================= PLATFORM LAYER =================
+ * Sockets, polling, threads, locks and clocks for the collector.
+ *
+ *   Windows : winsock2, select(), CRITICAL_SECTION, CreateThread
+ *   Linux   : non-blocking UDP, epoll, recvmmsg/sendmmsg, pthreads
+ *
+ * Include this header FIRST so _GNU_SOURCE is seen before libc.
+ */
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#ifndef _WIN32
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <io.h>
+#include <time.h>
+#pragma comment(lib,"ws2_32.lib")
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
+#define MAX_DATAGRAM 1024      // largest datagram we accept
+#define RECV_BATCH   64        // datagrams per recvmmsg call
+#define SOCK_RCVBUF  (4 * 1024 * 1024)
+#define POLLER_MAX   64        // FD_SETSIZE on Windows
+
+#define NET_NONBLOCK  0x1
+#define NET_REUSEPORT 0x2
+
+/* ---------- TYPES ---------- */
+#ifdef _WIN32
+typedef SOCKET sock_t;
+#define INVALID_SOCK INVALID_SOCKET
+typedef CRITICAL_SECTION Mutex;
+typedef DWORD (WINAPI *ThreadFn)(LPVOID);
+#define THREAD_FUNC(name) DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0
+#define THREAD_LOCAL __declspec(thread)
+#else
+typedef int sock_t;
+#define INVALID_SOCK (-1)
+typedef pthread_mutex_t Mutex;
+typedef void *(*ThreadFn)(void *);
+#define THREAD_FUNC(name) void *name(void *arg)
+#define THREAD_RETURN return NULL
+#define THREAD_LOCAL _Thread_local
+#endif
+
+/* ---------- NETWORK INIT ---------- */
+static inline int netInit(void) {
+#ifdef _WIN32
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2,2), &wsa) == 0 ? 0 : -1;
+#else
+    return 0;
+#endif
+}
+
+static inline void netCleanup(void) {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static inline void sockClose(sock_t s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+static inline int sockWouldBlock(void) {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+/* Bounds blocking recv/send on s, so one silent peer cannot hold a
+   single-threaded server forever. */
+static inline void sockTimeouts(sock_t s, int ms) {
+#ifdef _WIN32
+    DWORD tv = (DWORD)ms;
+#else
+    struct timeval tv = { ms / 1000, (ms % 1000) * 1000 };
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof(tv));
+}
+
+/* ---------- OPEN UDP SOCKET ----------
+ * port 0 binds nothing (client side). NET_REUSEPORT is Linux only;
+ * Windows SO_REUSEADDR has different semantics so it is ignored.
+ */
+static inline sock_t udpOpen(unsigned short port, int flags) {
+    sock_t s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == INVALID_SOCK) return INVALID_SOCK;
+
+    int rcvbuf = SOCK_RCVBUF;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+
+#ifndef _WIN32
+    if (flags & NET_REUSEPORT) {
+        int on = 1;
+        if (setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+            sockClose(s);
+            return INVALID_SOCK;
+        }
+    }
+#endif
+
+    if (flags & NET_NONBLOCK) {
+#ifdef _WIN32
+        u_long nb = 1;
+        ioctlsocket(s, FIONBIO, &nb);
+#else
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    }
+
+    if (port) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = INADDR_ANY;
+
+        if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            sockClose(s);
+            return INVALID_SOCK;
+        }
+    }
+    return s;
+}
+
+/* ---------- TCP LISTEN ----------
+ * Blocking listener for local control sockets (query, stats).
+ * loopback = 1 binds 127.0.0.1 only.
+ */
+static inline sock_t tcpListen(unsigned short port, int loopback) {
+    sock_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCK) return INVALID_SOCK;
+
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+
+    if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(s, 16) != 0) {
+        sockClose(s);
+        return INVALID_SOCK;
+    }
+    return s;
+}
+
+/* Writes the whole buffer; returns 0 on success, -1 on error. */
+static inline int sendAll(sock_t s, const char *buf, size_t len) {
+    while (len > 0) {
+        int n = send(s, buf, (int)(len > 65536 ? 65536 : len), 0);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* ---------- PACKET BATCH ----------
+ * Fixed buffers for one recvmmsg/sendmmsg round. Every received
+ * datagram is NUL terminated so the text protocol can use str*().
+ */
+typedef struct {
+    int count;
+    char buf[RECV_BATCH][MAX_DATAGRAM];
+    int len[RECV_BATCH];
+    struct sockaddr_in addr[RECV_BATCH];
+#ifndef _WIN32
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+#endif
+} PacketBatch;
+
+static inline void batchInit(PacketBatch *b) {
+    memset(b, 0, sizeof(*b));
+#ifndef _WIN32
+    for (int i = 0; i < RECV_BATCH; i++) {
+        b->iov[i].iov_base = b->buf[i];
+        b->iov[i].iov_len = MAX_DATAGRAM - 1;
+        b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+        b->msgs[i].msg_hdr.msg_iovlen = 1;
+        b->msgs[i].msg_hdr.msg_name = &b->addr[i];
+        b->msgs[i].msg_hdr.msg_namelen = sizeof(b->addr[i]);
+    }
+#endif
+}
+
+/* ---------- RECEIVE BATCH ----------
+ * Returns datagrams received, 0 when the socket is drained,
+ * -1 on error. Never blocks on a NET_NONBLOCK socket.
+ */
+static inline int udpRecvBatch(sock_t s, PacketBatch *b) {
+#ifdef _WIN32
+    int n = 0;
+    while (n < RECV_BATCH) {
+        int addrLen = sizeof(b->addr[n]);
+        int bytes = recvfrom(s, b->buf[n], MAX_DATAGRAM - 1, 0,
+                             (struct sockaddr*)&b->addr[n], &addrLen);
+        if (bytes < 0) {
+            if (n > 0 || sockWouldBlock()) break;
+            return -1;
+        }
+        b->buf[n][bytes] = '\0';
+        b->len[n] = bytes;
+        n++;
+    }
+    b->count = n;
+    return n;
+#else
+    for (int i = 0; i < RECV_BATCH; i++) {
+        b->iov[i].iov_len = MAX_DATAGRAM - 1;
+        b->msgs[i].msg_hdr.msg_namelen = sizeof(b->addr[i]);
+    }
+
+    int n = recvmmsg(s, b->msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+        b->count = 0;
+        return sockWouldBlock() ? 0 : -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        b->len[i] = (int)b->msgs[i].msg_len;
+        b->buf[i][b->len[i]] = '\0';
+    }
+    b->count = n;
+    return n;
+#endif
+}
+
+/* ---------- SEND BATCH ----------
+ * Sends buf[0..count) to addr[0..count). Returns datagrams sent.
+ */
+static inline int udpSendBatch(sock_t s, PacketBatch *b, int count) {
+#ifdef _WIN32
+    int sent = 0;
+    for (int i = 0; i < count; i++) {
+        if (sendto(s, b->buf[i], b->len[i], 0,
+                   (struct sockaddr*)&b->addr[i], sizeof(b->addr[i])) < 0)
+            break;
+        sent++;
+    }
+    return sent;
+#else
+    for (int i = 0; i < count; i++) {
+        b->iov[i].iov_len = b->len[i];
+        b->msgs[i].msg_hdr.msg_namelen = sizeof(b->addr[i]);
+    }
+
+    int sent = 0;
+    while (sent < count) {
+        int n = sendmmsg(s, b->msgs + sent, count - sent, 0);
+        if (n <= 0) break;
+        sent += n;
+    }
+    return sent;
+#endif
+}
+
+/* ---------- POLLER ----------
+ * Readiness wait over a handful of sockets. Each socket carries an
+ * integer tag that pollerWait reports back when it is readable.
+ */
+typedef struct {
+#ifdef _WIN32
+    sock_t socks[POLLER_MAX];
+    int tags[POLLER_MAX];
+    int count;
+#else
+    int epfd;
+#endif
+} Poller;
+
+static inline int pollerInit(Poller *p) {
+#ifdef _WIN32
+    p->count = 0;
+    return 0;
+#else
+    p->epfd = epoll_create1(0);
+    return p->epfd < 0 ? -1 : 0;
+#endif
+}
+
+static inline int pollerAdd(Poller *p, sock_t s, int tag) {
+#ifdef _WIN32
+    if (p->count >= POLLER_MAX) return -1;
+    p->socks[p->count] = s;
+    p->tags[p->count] = tag;
+    p->count++;
+    return 0;
+#else
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)tag;
+    return epoll_ctl(p->epfd, EPOLL_CTL_ADD, s, &ev);
+#endif
+}
+
+/* Returns number of ready tags written to tags[], 0 on timeout. */
+static inline int pollerWait(Poller *p, int *tags, int maxTags, int timeoutMs) {
+#ifdef _WIN32
+    fd_set rd;
+    FD_ZERO(&rd);
+    for (int i = 0; i < p->count; i++)
+        FD_SET(p->socks[i], &rd);
+
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+    if (select(0, &rd, NULL, NULL, timeoutMs < 0 ? NULL : &tv) <= 0)
+        return 0;
+
+    int n = 0;
+    for (int i = 0; i < p->count && n < maxTags; i++)
+        if (FD_ISSET(p->socks[i], &rd))
+            tags[n++] = p->tags[i];
+    return n;
+#else
+    struct epoll_event evs[POLLER_MAX];
+    if (maxTags > POLLER_MAX) maxTags = POLLER_MAX;
+
+    int n = epoll_wait(p->epfd, evs, maxTags, timeoutMs);
+    if (n <= 0) return 0;
+
+    for (int i = 0; i < n; i++)
+        tags[i] = (int)evs[i].data.u32;
+    return n;
+#endif
+}
+
+static inline void pollerClose(Poller *p) {
+#ifndef _WIN32
+    close(p->epfd);
+#else
+    (void)p;
+#endif
+}
+
+/* ---------- MUTEX ---------- */
+static inline void mutexInit(Mutex *m) {
+#ifdef _WIN32
+    InitializeCriticalSection(m);
+#else
+    pthread_mutex_init(m, NULL);
+#endif
+}
+
+static inline void mutexLock(Mutex *m) {
+#ifdef _WIN32
+    EnterCriticalSection(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+static inline void mutexUnlock(Mutex *m) {
+#ifdef _WIN32
+    LeaveCriticalSection(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+static inline void mutexDestroy(Mutex *m) {
+#ifdef _WIN32
+    DeleteCriticalSection(m);
+#else
+    pthread_mutex_destroy(m);
+#endif
+}
+
+/* ---------- THREADS ---------- */
+static inline int startThread(ThreadFn fn, void *param) {
+#ifdef _WIN32
+    HANDLE h = CreateThread(NULL, 0, fn, param, 0, NULL);
+    if (!h) return -1;
+    CloseHandle(h);
+    return 0;
+#else
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, fn, param) != 0) return -1;
+    pthread_detach(tid);
+    return 0;
+#endif
+}
+
+/* ---------- FILES ---------- */
+/* Flush stdio and force the file's data to disk. */
+static inline void fileSync(FILE *fp) {
+    fflush(fp);
+#ifdef _WIN32
+    _commit(_fileno(fp));
+#else
+    fsync(fileno(fp));
+#endif
+}
+
+/* ---------- TIME ---------- */
+static inline void sleepMs(unsigned int ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* Monotonic milliseconds, for intervals only. */
+static inline uint64_t nowMs(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#endif
+}
+
+/* Thread-safe localtime(). */
+static inline void localTime(time_t when, struct tm *out) {
+#ifdef _WIN32
+    localtime_s(out, &when);
+#else
+    localtime_r(&when, out);
+#endif
+}
+
+/* Unix time in milliseconds (wall clock, for timestamps). */
+static inline uint64_t wallMs(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return t / 10000 - 11644473600000ULL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#endif
+}
+
+#endif
@@ -0,0 +1,292 @@
+/* ================= WIRE PROTOCOL v2 =================
+ * Fixed-layout binary frame, little endian, one datagram per reading
+ * (or per batch of readings).
+ * Replaces the text NODE:/DATA:/EOF triple; the server still accepts
+ * v1 text and tells the two apart by the first byte (v1 is ASCII).
+ *
+ *   off size  field
+ *    0   2    magic    0xF1 0x0D
+ *    2   1    version  2
+ *    3   1    type     REGISTER / HEARTBEAT / DATA / BATCH / ACK,
+ *                      bit 7 (FRAME_ACK_REQ) on DATA/BATCH asks for ACKs
+ *    4   4    nodeId
+ *    8   4    seq      per-node, incremented for every reading
+ *   --- DATA: one reading ---
+ *   12   8    time     unix milliseconds at the node
+ *   20   2    temp     int16,  hundredths of a degree C
+ *   22   2    hum      uint16, hundredths of a percent
+ *   24   2    soil     uint16
+ *   26   2    water    uint16
+ *   --- BATCH: several readings coalesced by the node ---
+ *   12   2    count
+ *   14   16*count readings as above; reading i has sequence seq+i
+ *   --- ACK (server -> node): selective acknowledgement ---
+ *    8   4    seq      cumulative: every reading below it has arrived
+ *   12   8    sack     bit k set: reading seq+1+k has arrived
+ *   --- POLICY (server -> node): send policy update ---
+ *    8   4    seq      policy version
+ *   12   2    mask     which values below to apply (POLICY_* bits)
+ *   14   48   delta, deadband, rate: float32 each, per sensor in
+ *             Reading order (temp, hum, soil, water)
+ *   62   4    maxSilenceMs
+ *   --- POLICY (node -> server): header only, seq = version applied
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define WIRE_MAGIC0    0xF1
+#define WIRE_MAGIC1    0x0D
+#define WIRE_VERSION   2
+
+#define FRAME_REGISTER  1
+#define FRAME_HEARTBEAT 2
+#define FRAME_DATA      3
+#define FRAME_BATCH     4
+#define FRAME_ACK       5
+#define FRAME_POLICY    6
+
+#define FRAME_ACK_REQ   0x80
+#define FRAME_TYPE_MASK 0x7F
+
+#define FRAME_HEADER_SIZE 12
+#define READING_SIZE      16
+#define BATCH_HEADER_SIZE (FRAME_HEADER_SIZE + 2)
+#define BATCH_MAX_READINGS 32
+#define ACK_SIZE          (FRAME_HEADER_SIZE + 8)
+#define FRAME_MAX_SIZE    (BATCH_HEADER_SIZE + BATCH_MAX_READINGS * READING_SIZE)
+
+#define POLICY_METRICS    4
+#define POLICY_PARAMS     3             // delta, deadband, rate
+#define POLICY_SIZE       (FRAME_HEADER_SIZE + 2 + POLICY_METRICS * POLICY_PARAMS * 4 + 4)
+#define POLICY_SILENCE    (1 << (POLICY_METRICS * POLICY_PARAMS))
+
+typedef struct {
+    int type;
+    uint32_t nodeId;
+    uint32_t seq;
+    int ackReq;         // sender keeps the readings until acknowledged
+    uint64_t sack;      // ACK only
+} FrameHeader;
+
+typedef struct {
+    uint64_t timeMs;
+    float temp;
+    float hum;
+    int soil;
+    int water;
+} Reading;
+
+/* Values for one POLICY frame. Bit (metric * POLICY_PARAMS + param)
+   of mask marks value[metric][param] as set; POLICY_SILENCE marks
+   maxSilenceMs. */
+typedef struct {
+    uint16_t mask;
+    float value[POLICY_METRICS][POLICY_PARAMS];
+    uint32_t maxSilenceMs;
+} PolicyUpdate;
+
+/* ---------- BYTE ORDER ---------- */
+static inline void put16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void put32(unsigned char *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline void put64(unsigned char *p, uint64_t v) {
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint16_t get16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const unsigned char *p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static inline uint64_t get64(const unsigned char *p) {
+    return (uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+static inline void putF32(unsigned char *p, float v) {
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    put32(p, u);
+}
+
+static inline float getF32(const unsigned char *p) {
+    uint32_t u = get32(p);
+    float v;
+    memcpy(&v, &u, 4);
+    return v;
+}
+
+/* round to hundredths, clamped to the field range */
+static inline int32_t toCenti(float v, int32_t lo, int32_t hi) {
+    float c = v * 100.0f;
+    int32_t r = (int32_t)(c < 0 ? c - 0.5f : c + 0.5f);
+    return r < lo ? lo : r > hi ? hi : r;
+}
+
+static inline uint16_t clampU16(int v) {
+    return (uint16_t)(v < 0 ? 0 : v > 65535 ? 65535 : v);
+}
+
+/* ---------- DETECT ---------- */
+static inline int isFrameV2(const unsigned char *buf, int len) {
+    return len >= FRAME_HEADER_SIZE &&
+           buf[0] == WIRE_MAGIC0 && buf[1] == WIRE_MAGIC1;
+}
+
+/* ---------- READING FIELDS ---------- */
+static inline void putReading(unsigned char *p, const Reading *r) {
+    put64(p, r->timeMs);
+    put16(p + 8, (uint16_t)(int16_t)toCenti(r->temp, -32768, 32767));
+    put16(p + 10, (uint16_t)toCenti(r->hum, 0, 65535));
+    put16(p + 12, clampU16(r->soil));
+    put16(p + 14, clampU16(r->water));
+}
+
+static inline void getReading(const unsigned char *p, Reading *r) {
+    r->timeMs = get64(p);
+    r->temp = (int16_t)get16(p + 8) / 100.0f;
+    r->hum = get16(p + 10) / 100.0f;
+    r->soil = get16(p + 12);
+    r->water = get16(p + 14);
+}
+
+static inline void putHeader(unsigned char *out, int type, uint32_t nodeId,
+                             uint32_t seq) {
+    out[0] = WIRE_MAGIC0;
+    out[1] = WIRE_MAGIC1;
+    out[2] = WIRE_VERSION;
+    out[3] = (unsigned char)type;
+    put32(out + 4, nodeId);
+    put32(out + 8, seq);
+}
+
+/* ---------- ENCODE ----------
+ * r may be NULL for REGISTER / HEARTBEAT. Returns frame length.
+ */
+static inline int encodeFrame(unsigned char *out, int type, uint32_t nodeId,
+                              uint32_t seq, const Reading *r) {
+    putHeader(out, type, nodeId, seq);
+
+    if (type != FRAME_DATA || !r)
+        return FRAME_HEADER_SIZE;
+
+    putReading(out + FRAME_HEADER_SIZE, r);
+    return FRAME_HEADER_SIZE + READING_SIZE;
+}
+
+/* ---------- ENCODE BATCH ----------
+ * Packs up to BATCH_MAX_READINGS readings with sequences
+ * firstSeq, firstSeq+1, ... into one frame. Returns frame length.
+ */
+static inline int encodeBatch(unsigned char *out, uint32_t nodeId,
+                              uint32_t firstSeq, const Reading *r, int count) {
+    if (count > BATCH_MAX_READINGS) count = BATCH_MAX_READINGS;
+
+    putHeader(out, FRAME_BATCH, nodeId, firstSeq);
+    put16(out + FRAME_HEADER_SIZE, (uint16_t)count);
+
+    for (int i = 0; i < count; i++)
+        putReading(out + BATCH_HEADER_SIZE + i * READING_SIZE, &r[i]);
+    return BATCH_HEADER_SIZE + count * READING_SIZE;
+}
+
+/* Marks an encoded DATA/BATCH frame as wanting acknowledgement. */
+static inline void frameRequestAck(unsigned char *frame) {
+    frame[3] |= FRAME_ACK_REQ;
+}
+
+/* ---------- ENCODE ACK ---------- */
+static inline int encodeAck(unsigned char *out, uint32_t nodeId,
+                            uint32_t cumSeq, uint64_t sack) {
+    putHeader(out, FRAME_ACK, nodeId, cumSeq);
+    put64(out + FRAME_HEADER_SIZE, sack);
+    return ACK_SIZE;
+}
+
+/* ---------- ENCODE POLICY ---------- */
+static inline int encodePolicy(unsigned char *out, uint32_t nodeId,
+                               uint32_t version, const PolicyUpdate *u) {
+    putHeader(out, FRAME_POLICY, nodeId, version);
+    unsigned char *p = out + FRAME_HEADER_SIZE;
+    put16(p, u->mask);
+    p += 2;
+    for (int m = 0; m < POLICY_METRICS; m++)
+        for (int k = 0; k < POLICY_PARAMS; k++, p += 4)
+            putF32(p, u->value[m][k]);
+    put32(p, u->maxSilenceMs);
+    return POLICY_SIZE;
+}
+
+/* Payload of a server -> node POLICY frame; 0 on success. */
+static inline int decodePolicy(const unsigned char *buf, int len, PolicyUpdate *u) {
+    if (len < POLICY_SIZE) return -1;
+    const unsigned char *p = buf + FRAME_HEADER_SIZE;
+    u->mask = get16(p);
+    p += 2;
+    for (int m = 0; m < POLICY_METRICS; m++)
+        for (int k = 0; k < POLICY_PARAMS; k++, p += 4)
+            u->value[m][k] = getF32(p);
+    u->maxSilenceMs = get32(p);
+    return 0;
+}
+
+/* ---------- DECODE ----------
+ * Parses the header and any readings (DATA: one, BATCH: count) into
+ * r[0..max). Returns the number of readings, or -1 if the frame is
+ * malformed or from a newer protocol version.
+ */
+static inline int decodeFrame(const unsigned char *buf, int len,
+                              FrameHeader *h, Reading *r, int max) {
+    if (!isFrameV2(buf, len) || buf[2] != WIRE_VERSION)
+        return -1;
+
+    h->type = buf[3] & FRAME_TYPE_MASK;
+    h->ackReq = (buf[3] & FRAME_ACK_REQ) != 0;
+    h->nodeId = get32(buf + 4);
+    h->seq = get32(buf + 8);
+    h->sack = 0;
+
+    switch (h->type) {
+    case FRAME_REGISTER:
+    case FRAME_HEARTBEAT:
+    case FRAME_POLICY:          // payload (if any): decodePolicy()
+        return 0;
+
+    case FRAME_ACK:
+        if (len < ACK_SIZE) return -1;
+        h->sack = get64(buf + FRAME_HEADER_SIZE);
+        return 0;
+
+    case FRAME_DATA:
+        if (len < FRAME_HEADER_SIZE + READING_SIZE || max < 1)
+            return -1;
+        getReading(buf + FRAME_HEADER_SIZE, &r[0]);
+        return 1;
+
+    case FRAME_BATCH: {
+        if (len < BATCH_HEADER_SIZE) return -1;
+        int count = get16(buf + FRAME_HEADER_SIZE);
+        if (count > max || len < BATCH_HEADER_SIZE + count * READING_SIZE)
+            return -1;
+        for (int i = 0; i < count; i++)
+            getReading(buf + BATCH_HEADER_SIZE + i * READING_SIZE, &r[i]);
+        return count;
+    }
+    }
+    return -1;
+}
+
+#endif
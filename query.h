@@ -0,0 +1,125 @@
+/* ================= QUERY SOCKET =================
+ * Line protocol on a loopback TCP port. A client sends one command
+ * per line and gets one reply line back (JSON, or {"error":...}); the
+ * connection stays open for further commands, so the dashboard API
+ * keeps a single socket instead of re-reading the log per request.
+ *
+ * The command set lives in the server; this file only handles
+ * sockets, line splitting and the reply buffer. One thread per
+ * connection: there are only ever a handful of local readers.
+ */
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "platform.h"
+#include <stdarg.h>
+
+#define QUERY_PORT     8890
+#define QUERY_LINE_MAX 256
+
+/* ---------- REPLY BUFFER ---------- */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} StrBuf;
+
+static inline void sbReserve(StrBuf *sb, size_t extra) {
+    if (sb->len + extra + 1 <= sb->cap) return;
+    size_t cap = sb->cap ? sb->cap : 4096;
+    while (cap < sb->len + extra + 1) cap *= 2;
+    char *p = realloc(sb->buf, cap);
+    if (!p) return;
+    sb->buf = p;
+    sb->cap = cap;
+}
+
+static inline void sbPrintf(StrBuf *sb, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char tmp[256];
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+
+    sbReserve(sb, (size_t)n);
+    if (sb->len + (size_t)n + 1 > sb->cap) return;
+
+    if ((size_t)n < sizeof(tmp)) {
+        memcpy(sb->buf + sb->len, tmp, (size_t)n + 1);
+    } else {
+        va_start(ap, fmt);
+        vsnprintf(sb->buf + sb->len, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    sb->len += (size_t)n;
+}
+
+static inline void sbFree(StrBuf *sb) {
+    free(sb->buf);
+    sb->buf = NULL;
+    sb->len = sb->cap = 0;
+}
+
+/* ---------- SERVER ---------- */
+typedef void (*QueryHandler)(const char *line, StrBuf *out);
+
+static QueryHandler queryHandler;
+
+static THREAD_FUNC(queryConn) {
+    sock_t s = (sock_t)(intptr_t)arg;
+    char line[QUERY_LINE_MAX];
+    int used = 0;
+    StrBuf out = {0};
+
+    while (1) {
+        int n = recv(s, line + used, (int)(sizeof(line) - 1 - used), 0);
+        if (n <= 0) break;
+        used += n;
+
+        char *start = line;
+        char *nl;
+        while ((nl = memchr(start, '\n', (size_t)(line + used - start))) != NULL) {
+            *nl = '\0';
+            if (nl > start && nl[-1] == '\r') nl[-1] = '\0';
+
+            out.len = 0;
+            queryHandler(start, &out);
+            sbPrintf(&out, "\n");
+            if (sendAll(s, out.buf, out.len) != 0) goto done;
+
+            start = nl + 1;
+        }
+
+        used -= (int)(start - line);
+        memmove(line, start, (size_t)used);
+        if (used == (int)sizeof(line) - 1) break;   // over-long command
+    }
+
+done:
+    sbFree(&out);
+    sockClose(s);
+    THREAD_RETURN;
+}
+
+static THREAD_FUNC(queryListen) {
+    sock_t ls = (sock_t)(intptr_t)arg;
+    while (1) {
+        sock_t s = accept(ls, NULL, NULL);
+        if (s == INVALID_SOCK) { sleepMs(100); continue; }
+        if (startThread(queryConn, (void*)(intptr_t)s) != 0)
+            sockClose(s);
+    }
+    THREAD_RETURN;
+}
+
+/* Returns 0 once the listener is running. */
+static inline int queryStart(unsigned short port, QueryHandler handler) {
+    sock_t ls = tcpListen(port, 1);
+    if (ls == INVALID_SOCK) return -1;
+
+    queryHandler = handler;
+    return startThread(queryListen, (void*)(intptr_t)ls);
+}
+
+#endif
@@ -0,0 +1,303 @@
+/* ================= NODE REGISTRY =================
+ * Growable node table with O(1) lookup by source address and by
+ * nodeId. Client records live in chunks that never move (chunk k
+ * holds REGISTRY_INITIAL << k records), so an index into the table
+ * stays valid for good. Two open addressing indexes (linear probing,
+ * power-of-two size, at most half full) map keys to record indexes.
+ * An index slot is 16 bytes, so a probe sequence usually stays
+ * inside one cache line.
+ *
+ * Readers take no lock: registryFindAddr() / registryFindNode() and
+ * the atomic record fields (bound, lastSeen, active) can be used from
+ * any thread. Everything else (add, rebind, unbind, series, addr) is
+ * the writer path, guarded by the owning worker's shard lock. Writers
+ * update index slots in place with atomic stores; a reader probing
+ * while a slot is being moved may see a torn or missing entry, so
+ * every hit is checked against the record, and a miss is only
+ * authoritative under the lock. Growing swaps in new index tables
+ * and hands the old ones to epoch.h, so a reader still probing them
+ * is never left with freed memory.
+ */
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "platform.h"
+#include "epoch.h"
+#include <stdatomic.h>
+
+#define REGISTRY_INITIAL 16
+#define REGISTRY_CHUNKS  24             // 16 * (2^24 - 1) records
+#define CLIENT_BOUND     (1ULL << 63)
+
+struct Series;
+struct NodePolicy;
+
+typedef struct {
+    struct sockaddr_in addr;            // writer path only
+    int nodeId;                         // fixed once the record is published
+    _Atomic uint64_t bound;             // addrKey | CLIENT_BOUND, 0 = unbound
+    _Atomic uint64_t lastSeen;          // monotonic ms
+    atomic_int active;
+    struct Series *series;  // recent readings (tsstore.h), may be NULL; writer path
+    struct NodePolicy *policy;          // downlink send policy (server.c), writer path
+    atomic_int policyPending;           // policy sent but not yet acknowledged
+} Client;
+
+typedef struct {
+    _Atomic uint64_t key;
+    atomic_int idx;         // -1 = empty
+} IndexSlot;
+
+typedef struct {
+    uint32_t mask;
+    IndexSlot slots[];
+} IndexTable;
+
+typedef struct {
+    _Atomic(Client*) chunks[REGISTRY_CHUNKS];
+    atomic_int count;
+    int cap;
+
+    _Atomic(IndexTable*) byAddr;
+    _Atomic(IndexTable*) byNode;
+} Registry;
+
+/* ---------- KEYS ---------- */
+static inline uint64_t addrKey(const struct sockaddr_in *addr) {
+    return ((uint64_t)addr->sin_addr.s_addr << 16) | addr->sin_port;
+}
+
+static inline uint64_t nodeKey(int nodeId) {
+    return (uint64_t)(uint32_t)nodeId;
+}
+
+static inline uint32_t hashKey(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return (uint32_t)k;
+}
+
+/* ---------- RECORDS ---------- */
+static inline Client *registryAt(Registry *r, int idx) {
+    uint32_t v = (uint32_t)idx / REGISTRY_INITIAL + 1;
+    int k = 31 - __builtin_clz(v);
+    Client *chunk = atomic_load_explicit(&r->chunks[k], memory_order_acquire);
+    return chunk + (idx - REGISTRY_INITIAL * ((1 << k) - 1));
+}
+
+static inline int registryCount(Registry *r) {
+    return atomic_load_explicit(&r->count, memory_order_acquire);
+}
+
+static inline int clientBound(Client *c) {
+    return atomic_load(&c->bound) != 0;
+}
+
+/* ---------- INDEX OPS ----------
+ * Find is safe against a concurrent writer (it may miss, or return a
+ * stale index the caller must check); put and del are writer path.
+ */
+static inline int indexFind(IndexTable *t, uint64_t key) {
+    uint32_t i = hashKey(key) & t->mask;
+    for (uint32_t n = 0; n <= t->mask; n++, i = (i + 1) & t->mask) {
+        int idx = atomic_load_explicit(&t->slots[i].idx, memory_order_acquire);
+        if (idx == -1) return -1;
+        if (atomic_load_explicit(&t->slots[i].key, memory_order_relaxed) == key) return idx;
+    }
+    return -1;
+}
+
+/* Insert or overwrite: the latest record to claim a key wins. */
+static inline void indexPut(IndexTable *t, uint64_t key, int idx) {
+    uint32_t i = hashKey(key) & t->mask;
+    while (atomic_load_explicit(&t->slots[i].idx, memory_order_relaxed) != -1 &&
+           atomic_load_explicit(&t->slots[i].key, memory_order_relaxed) != key)
+        i = (i + 1) & t->mask;
+    atomic_store_explicit(&t->slots[i].key, key, memory_order_relaxed);
+    atomic_store_explicit(&t->slots[i].idx, idx, memory_order_release);
+}
+
+/* Remove key only if it still points at idx. Backward-shift delete
+   keeps probe chains intact without tombstones. */
+static inline void indexDel(IndexTable *t, uint64_t key, int idx) {
+    IndexSlot *s = t->slots;
+    uint32_t mask = t->mask;
+    uint32_t i = hashKey(key) & mask;
+    while (atomic_load_explicit(&s[i].idx, memory_order_relaxed) != -1 &&
+           atomic_load_explicit(&s[i].key, memory_order_relaxed) != key)
+        i = (i + 1) & mask;
+    if (atomic_load_explicit(&s[i].idx, memory_order_relaxed) != idx) return;
+
+    uint32_t hole = i;
+    for (uint32_t j = (hole + 1) & mask;
+         atomic_load_explicit(&s[j].idx, memory_order_relaxed) != -1; j = (j + 1) & mask) {
+        uint64_t k = atomic_load_explicit(&s[j].key, memory_order_relaxed);
+        uint32_t home = hashKey(k) & mask;
+        /* move j back if its home is not in (hole, j] */
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            atomic_store_explicit(&s[hole].key, k, memory_order_relaxed);
+            atomic_store_explicit(&s[hole].idx,
+                                  atomic_load_explicit(&s[j].idx, memory_order_relaxed),
+                                  memory_order_release);
+            hole = j;
+        }
+    }
+    atomic_store_explicit(&s[hole].idx, -1, memory_order_release);
+}
+
+static inline IndexTable *indexAlloc(uint32_t size) {
+    IndexTable *t = malloc(sizeof(IndexTable) + size * sizeof(IndexSlot));
+    if (!t) return NULL;
+    t->mask = size - 1;
+    for (uint32_t i = 0; i < size; i++) {
+        atomic_init(&t->slots[i].key, 0);
+        atomic_init(&t->slots[i].idx, -1);
+    }
+    return t;
+}
+
+/* ---------- INIT / FREE ---------- */
+static inline int registryInit(Registry *r) {
+    memset(r, 0, sizeof(*r));
+    r->cap = REGISTRY_INITIAL;
+    Client *chunk = calloc(REGISTRY_INITIAL, sizeof(Client));
+    IndexTable *byAddr = indexAlloc(REGISTRY_INITIAL * 2);
+    IndexTable *byNode = indexAlloc(REGISTRY_INITIAL * 2);
+    atomic_init(&r->chunks[0], chunk);
+    atomic_init(&r->byAddr, byAddr);
+    atomic_init(&r->byNode, byNode);
+    return (chunk && byAddr && byNode) ? 0 : -1;
+}
+
+/* No reader may be left when this runs. */
+static inline void registryFree(Registry *r) {
+    for (int k = 0; k < REGISTRY_CHUNKS; k++)
+        free(atomic_load(&r->chunks[k]));
+    free(atomic_load(&r->byAddr));
+    free(atomic_load(&r->byNode));
+    memset(r, 0, sizeof(*r));
+}
+
+/* ---------- GROW ----------
+ * Adds the next chunk (records already handed out stay where they
+ * are) and rebuilds both indexes at the new size so they stay at
+ * most half full. Readers switch tables when the pointer flips; the
+ * old tables go to epoch.h.
+ */
+static inline int registryGrow(Registry *r) {
+    int k = 31 - __builtin_clz((uint32_t)r->cap / REGISTRY_INITIAL + 1);
+    if (k >= REGISTRY_CHUNKS) return -1;
+    int cap = r->cap + (REGISTRY_INITIAL << k);
+
+    uint32_t size = atomic_load(&r->byAddr)->mask + 1;
+    while (size < (uint32_t)cap * 2) size <<= 1;
+
+    Client *chunk = calloc((size_t)REGISTRY_INITIAL << k, sizeof(Client));
+    IndexTable *byAddr = indexAlloc(size);
+    IndexTable *byNode = indexAlloc(size);
+    if (!chunk || !byAddr || !byNode) {
+        free(chunk);
+        free(byAddr);
+        free(byNode);
+        return -1;
+    }
+    atomic_store_explicit(&r->chunks[k], chunk, memory_order_release);
+
+    int count = registryCount(r);
+    for (int i = 0; i < count; i++) {
+        Client *c = registryAt(r, i);
+        uint64_t b = atomic_load(&c->bound);
+        if (b) indexPut(byAddr, b & ~CLIENT_BOUND, i);
+        indexPut(byNode, nodeKey(c->nodeId), i);
+    }
+
+    IndexTable *oldAddr = atomic_exchange(&r->byAddr, byAddr);
+    IndexTable *oldNode = atomic_exchange(&r->byNode, byNode);
+    epochRetire(oldAddr, free);
+    epochRetire(oldNode, free);
+    r->cap = cap;
+    return 0;
+}
+
+/* ---------- LOOKUP ----------
+ * Lock-free. A hit is checked against its record; a miss may be a
+ * slot being moved by a concurrent writer, so callers that must know
+ * the node is absent repeat the lookup under the shard lock.
+ */
+static inline int registryFindAddr(Registry *r, const struct sockaddr_in *addr) {
+    uint64_t key = addrKey(addr);
+    epochEnter();
+    int idx = indexFind(atomic_load(&r->byAddr), key);
+    epochExit();
+
+    if (idx < 0 || idx >= registryCount(r) ||
+        atomic_load(&registryAt(r, idx)->bound) != (key | CLIENT_BOUND))
+        return -1;
+    return idx;
+}
+
+static inline int registryFindNode(Registry *r, int nodeId) {
+    epochEnter();
+    int idx = indexFind(atomic_load(&r->byNode), nodeKey(nodeId));
+    epochExit();
+
+    if (idx < 0 || idx >= registryCount(r) || registryAt(r, idx)->nodeId != nodeId)
+        return -1;
+    return idx;
+}
+
+/* ---------- ADD ----------
+ * Appends a bound, active record. Returns its index, -1 if out of
+ * memory.
+ */
+static inline int registryAdd(Registry *r, const struct sockaddr_in *addr, int nodeId) {
+    int idx = registryCount(r);
+    if (idx == r->cap && registryGrow(r) != 0)
+        return -1;
+
+    Client *c = registryAt(r, idx);
+    c->addr = *addr;
+    c->nodeId = nodeId;
+    c->series = NULL;
+    c->policy = NULL;
+    atomic_store(&c->policyPending, 0);
+    atomic_store(&c->lastSeen, nowMs());
+    atomic_store(&c->active, 1);
+    atomic_store(&c->bound, addrKey(addr) | CLIENT_BOUND);
+    atomic_store_explicit(&r->count, idx + 1, memory_order_release);
+
+    indexPut(atomic_load(&r->byAddr), addrKey(addr), idx);
+    indexPut(atomic_load(&r->byNode), nodeKey(nodeId), idx);
+    return idx;
+}
+
+/* ---------- REBIND ADDRESS ----------
+ * Moves a record to a new source address and marks it bound.
+ */
+static inline void registrySetAddr(Registry *r, int idx, const struct sockaddr_in *addr) {
+    Client *c = registryAt(r, idx);
+    IndexTable *t = atomic_load(&r->byAddr);
+    if (clientBound(c))
+        indexDel(t, addrKey(&c->addr), idx);
+
+    c->addr = *addr;
+    atomic_store(&c->bound, addrKey(addr) | CLIENT_BOUND);
+    indexPut(t, addrKey(addr), idx);
+}
+
+/* ---------- UNREGISTER ----------
+ * Drops the address binding; the record stays findable by nodeId.
+ */
+static inline void registryUnbind(Registry *r, int idx) {
+    Client *c = registryAt(r, idx);
+    if (!clientBound(c)) return;
+
+    indexDel(atomic_load(&r->byAddr), addrKey(&c->addr), idx);
+    atomic_store(&c->bound, 0);
+    atomic_store(&c->active, 0);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/* ================= ROLLUPS =================
+   Downsampled chart buckets in the same shape as the server's ROLLUP
+   query (tsstore.h), computed here when the query socket is not
+   available. Tier choice follows seriesPickTier(): the finest tier
+   whose bucket count fits maxPoints and whose retention covers the
+   start of the range. */
+
+const TIERS = [
+  { name: "1m", spanMs: 60 * 1000, keep: 24 * 60 },
+  { name: "1h", spanMs: 60 * 60 * 1000, keep: 31 * 24 },
+  { name: "1d", spanMs: 24 * 60 * 60 * 1000, keep: 366 }
+];
+
+const METRICS = ["temperature", "humidity", "soil", "water"];
+
+function pickTier(fromMs, toMs, nowMs, maxPoints) {
+  for (const tier of TIERS) {
+    const oldest = nowMs - tier.spanMs * tier.keep;
+    if (Math.floor((toMs - fromMs) / tier.spanMs) + 1 <= maxPoints && fromMs >= oldest)
+      return tier;
+  }
+  return TIERS[TIERS.length - 1];
+}
+
+/* "YYYY-MM-DD HH:MM:SS" (local time) or unix ms -> unix ms */
+function timeOf(time) {
+  return typeof time === "number" ? time : new Date(time.replace(" ", "T")).getTime();
+}
+
+/* each(visit) must call visit(reading) for every candidate reading of
+   the node, in any order; readings outside [fromMs, toMs] are skipped. */
+function rollup(node, each, fromMs, toMs, maxPoints, nowMs = Date.now()) {
+  const tier = pickTier(fromMs, toMs, nowMs, maxPoints);
+  const buckets = new Map();
+
+  each(r => {
+    const t = timeOf(r.time);
+    if (!(t >= fromMs && t <= toMs)) return;
+    const start = t - (t % tier.spanMs);
+
+    let b = buckets.get(start);
+    if (!b) {
+      b = { time: start, count: 0, firstMs: t, lastMs: t };
+      for (const m of METRICS) b[m] = { sum: 0, min: Infinity, max: -Infinity, last: 0 };
+      buckets.set(start, b);
+    }
+    b.count++;
+    if (t < b.firstMs) b.firstMs = t;
+    for (const m of METRICS) {
+      const agg = b[m];
+      agg.sum += r[m];
+      agg.min = Math.min(agg.min, r[m]);
+      agg.max = Math.max(agg.max, r[m]);
+      if (t >= b.lastMs) agg.last = r[m];
+    }
+    if (t > b.lastMs) b.lastMs = t;
+  });
+
+  return {
+    node,
+    tier: tier.name,
+    spanMs: tier.spanMs,
+    points: [...buckets.values()]
+      .sort((a, b) => a.time - b.time)
+      .slice(-tier.keep)
+      .map(b => {
+        for (const m of METRICS) b[m].sum = Number(b[m].sum.toFixed(2));
+        return b;
+      })
+  };
+}
+
+module.exports = { TIERS, pickTier, rollup };
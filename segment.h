@@ -0,0 +1,470 @@
+/* ================= BINARY SEGMENT LOG =================
+ * Fixed-width event records written next to server_log.txt, so a
+ * "Node3, last hour" query seeks instead of regex-scanning text.
+ * Records go to segment files that rotate by size; every segment has
+ * a sidecar index with one entry per block of SEG_BLOCK records.
+ * segRetain() deletes old segments by count and age, like the
+ * rotated text logs.
+ *
+ *   seg-<first record ms>.dat
+ *    off size
+ *     0   4   magic    "NSEG"
+ *     4   2   version  1
+ *     6   2   record size (24)
+ *     8   8   reserved
+ *    16  24*n records
+ *
+ *   record (little endian, same field encoding as the v2 wire frame)
+ *     0   8   time     unix milliseconds
+ *     8   4   nodeId
+ *    12   1   event    SEG_DATA / SEG_REGISTER / ...
+ *    13   1   reserved
+ *    14   2   temp     int16,  hundredths of a degree C   (DATA only)
+ *    16   2   hum      uint16, hundredths of a percent
+ *    18   2   soil     uint16
+ *    20   2   water    uint16
+ *    22   2   reserved
+ *
+ *   seg-<first record ms>.idx, one entry per full block
+ *     0   8   min time in block
+ *     8   8   max time in block
+ *    16   4   first record number
+ *    20   4   record count
+ *    24   8   node mask, bit (nodeId & 63) set if the block holds it
+ *
+ * Records in the tail block of a segment are not indexed yet; readers
+ * scan them directly (at most SEG_BLOCK - 1 records).
+ */
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "platform.h"
+#include "protocol.h"
+#include <errno.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <dirent.h>
+#endif
+
+#define SEG_DIR          "segments"
+#define SEG_HEADER_SIZE  16
+#define SEG_RECORD_SIZE  24
+#define SEG_INDEX_SIZE   32
+#define SEG_BLOCK        256
+#define SEG_MAX_BYTES    (64L * 1024 * 1024)
+#define SEG_PATH_MAX     512
+
+enum {
+    SEG_DATA = 1,
+    SEG_REGISTER,
+    SEG_RECONNECT,
+    SEG_DISCONNECT,
+    SEG_UNKNOWN,
+    SEG_POLICY,                 // a node acknowledged a send policy push
+    SEG_ALERT                   // flood level / flash flood change (flood.h)
+};
+
+typedef struct {
+    uint64_t timeMs;
+    uint32_t nodeId;
+    int event;
+    Reading reading;        // DATA only; reading.timeMs unused
+} SegRecord;
+
+typedef struct {
+    uint64_t minMs;
+    uint64_t maxMs;
+    uint32_t first;
+    uint32_t count;
+    uint64_t nodeMask;
+} SegBlock;
+
+/* ---------- EVENT NAMES ---------- */
+static inline int segEventCode(const char *event) {
+    if (strcmp(event, "DATA") == 0)       return SEG_DATA;
+    if (strcmp(event, "REGISTER") == 0)   return SEG_REGISTER;
+    if (strcmp(event, "RECONNECT") == 0)  return SEG_RECONNECT;
+    if (strcmp(event, "DISCONNECT") == 0) return SEG_DISCONNECT;
+    if (strcmp(event, "POLICY") == 0)     return SEG_POLICY;
+    if (strcmp(event, "ALERT") == 0)      return SEG_ALERT;
+    return SEG_UNKNOWN;
+}
+
+static inline const char *segEventName(int code) {
+    switch (code) {
+    case SEG_DATA:       return "DATA";
+    case SEG_REGISTER:   return "REGISTER";
+    case SEG_RECONNECT:  return "RECONNECT";
+    case SEG_DISCONNECT: return "DISCONNECT";
+    case SEG_POLICY:     return "POLICY";
+    case SEG_ALERT:      return "ALERT";
+    }
+    return "UNKNOWN";
+}
+
+static inline uint64_t segNodeBit(uint32_t nodeId) {
+    return 1ULL << (nodeId & 63);
+}
+
+/* ---------- ENCODE / DECODE ---------- */
+static inline void segPutRecord(unsigned char *p, const SegRecord *r) {
+    memset(p, 0, SEG_RECORD_SIZE);
+    put64(p, r->timeMs);
+    put32(p + 8, r->nodeId);
+    p[12] = (unsigned char)r->event;
+    if (r->event == SEG_DATA) {
+        put16(p + 14, (uint16_t)(int16_t)toCenti(r->reading.temp, -32768, 32767));
+        put16(p + 16, (uint16_t)toCenti(r->reading.hum, 0, 65535));
+        put16(p + 18, clampU16(r->reading.soil));
+        put16(p + 20, clampU16(r->reading.water));
+    }
+}
+
+static inline void segGetRecord(const unsigned char *p, SegRecord *r) {
+    r->timeMs = get64(p);
+    r->nodeId = get32(p + 8);
+    r->event = p[12];
+    r->reading.timeMs = r->timeMs;
+    r->reading.temp = (int16_t)get16(p + 14) / 100.0f;
+    r->reading.hum = get16(p + 16) / 100.0f;
+    r->reading.soil = get16(p + 18);
+    r->reading.water = get16(p + 20);
+}
+
+static inline void segPutBlock(unsigned char *p, const SegBlock *b) {
+    put64(p, b->minMs);
+    put64(p + 8, b->maxMs);
+    put32(p + 16, b->first);
+    put32(p + 20, b->count);
+    put64(p + 24, b->nodeMask);
+}
+
+static inline void segGetBlock(const unsigned char *p, SegBlock *b) {
+    b->minMs = get64(p);
+    b->maxMs = get64(p + 8);
+    b->first = get32(p + 16);
+    b->count = get32(p + 20);
+    b->nodeMask = get64(p + 24);
+}
+
+static inline int segMakeDir(const char *dir) {
+#ifdef _WIN32
+    return _mkdir(dir) == 0 || errno == EEXIST ? 0 : -1;
+#else
+    return mkdir(dir, 0755) == 0 || errno == EEXIST ? 0 : -1;
+#endif
+}
+
+/* ================= WRITER ================= */
+typedef struct {
+    char dir[SEG_PATH_MAX];
+    long maxBytes;
+
+    FILE *dat;
+    FILE *idx;
+    char path[SEG_PATH_MAX + 32];   // open .dat, "" when closed
+    uint32_t records;       // in the open segment
+    SegBlock block;         // block being filled
+} SegWriter;
+
+static inline int segWriterInit(SegWriter *w, const char *dir, long maxBytes) {
+    memset(w, 0, sizeof(*w));
+    snprintf(w->dir, sizeof(w->dir), "%s", dir);
+    w->maxBytes = maxBytes > 0 ? maxBytes : SEG_MAX_BYTES;
+    return segMakeDir(dir);
+}
+
+static inline void segClose(SegWriter *w) {
+    if (!w->dat) return;
+    if (w->block.count) {
+        unsigned char e[SEG_INDEX_SIZE];
+        segPutBlock(e, &w->block);
+        fwrite(e, 1, sizeof(e), w->idx);
+    }
+    fclose(w->dat);
+    fclose(w->idx);
+    w->dat = w->idx = NULL;
+    w->path[0] = '\0';
+}
+
+/* Starts a segment named after its first record's time. */
+static inline int segOpenNext(SegWriter *w, uint64_t firstMs) {
+    char path[SEG_PATH_MAX + 32];
+    FILE *probe;
+
+    /* two segments can start in the same millisecond: bump the name */
+    for (;; firstMs++) {
+        snprintf(path, sizeof(path), "%s/seg-%013llu.dat",
+                 w->dir, (unsigned long long)firstMs);
+        if ((probe = fopen(path, "rb")) == NULL) break;
+        fclose(probe);
+    }
+
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    w->dat = fopen(path, "wb");
+    path[strlen(path) - 3] = '\0';
+    strcat(path, "idx");
+    w->idx = fopen(path, "wb");
+    if (!w->dat || !w->idx) {
+        if (w->dat) fclose(w->dat);
+        if (w->idx) fclose(w->idx);
+        w->dat = w->idx = NULL;
+        w->path[0] = '\0';
+        return -1;
+    }
+
+    unsigned char h[SEG_HEADER_SIZE] = { 'N', 'S', 'E', 'G' };
+    put16(h + 4, 1);
+    put16(h + 6, SEG_RECORD_SIZE);
+    fwrite(h, 1, sizeof(h), w->dat);
+
+    w->records = 0;
+    memset(&w->block, 0, sizeof(w->block));
+    return 0;
+}
+
+/* ---------- APPEND ----------
+ * Buffered; call segFlush() to push to the OS. Returns -1 if the
+ * segment could not be opened.
+ */
+static inline int segAppend(SegWriter *w, const SegRecord *r) {
+    if (w->dat &&
+        SEG_HEADER_SIZE + (long)(w->records + 1) * SEG_RECORD_SIZE > w->maxBytes)
+        segClose(w);
+    if (!w->dat && segOpenNext(w, r->timeMs) != 0)
+        return -1;
+
+    unsigned char p[SEG_RECORD_SIZE];
+    segPutRecord(p, r);
+    fwrite(p, 1, sizeof(p), w->dat);
+
+    SegBlock *b = &w->block;
+    if (b->count == 0) {
+        b->first = w->records;
+        b->minMs = b->maxMs = r->timeMs;
+        b->nodeMask = 0;
+    }
+    if (r->timeMs < b->minMs) b->minMs = r->timeMs;
+    if (r->timeMs > b->maxMs) b->maxMs = r->timeMs;
+    b->nodeMask |= segNodeBit(r->nodeId);
+    b->count++;
+    w->records++;
+
+    if (b->count == SEG_BLOCK) {
+        unsigned char e[SEG_INDEX_SIZE];
+        segPutBlock(e, b);
+        fwrite(e, 1, sizeof(e), w->idx);
+        b->count = 0;
+    }
+    return 0;
+}
+
+static inline void segFlush(SegWriter *w) {
+    if (!w->dat) return;
+    fflush(w->dat);
+    fflush(w->idx);
+}
+
+/* ================= READER ================= */
+
+/* Return nonzero from the callback to stop the scan. */
+typedef int (*SegVisit)(void *ctx, const SegRecord *r);
+
+typedef struct {
+    uint64_t fromMs;
+    uint64_t toMs;
+    int64_t nodeId;         // -1 = any
+    SegVisit visit;
+    void *ctx;
+} SegQuery;
+
+static inline int segMatch(const SegQuery *q, const SegRecord *r) {
+    return r->timeMs >= q->fromMs && r->timeMs <= q->toMs &&
+           (q->nodeId < 0 || r->nodeId == (uint32_t)q->nodeId);
+}
+
+/* Reads records [first, first+count) and visits the matching ones. */
+static inline int segScanRange(FILE *fp, uint32_t first, uint32_t count,
+                               const SegQuery *q) {
+    unsigned char buf[SEG_BLOCK * SEG_RECORD_SIZE];
+    if (fseek(fp, SEG_HEADER_SIZE + (long)first * SEG_RECORD_SIZE, SEEK_SET) != 0)
+        return 0;
+
+    while (count > 0) {
+        uint32_t n = count < SEG_BLOCK ? count : SEG_BLOCK;
+        size_t got = fread(buf, SEG_RECORD_SIZE, n, fp);
+        for (size_t i = 0; i < got; i++) {
+            SegRecord r;
+            segGetRecord(buf + i * SEG_RECORD_SIZE, &r);
+            if (segMatch(q, &r) && q->visit(q->ctx, &r))
+                return 1;
+        }
+        if (got < n) break;
+        count -= n;
+    }
+    return 0;
+}
+
+/* ---------- QUERY ONE SEGMENT ----------
+ * Uses the sidecar index to skip blocks outside the time range or
+ * without the node, then scans the unindexed tail.
+ * Returns 1 if the visitor stopped the scan.
+ */
+static inline int segQueryFile(const char *datPath, const SegQuery *q) {
+    FILE *dat = fopen(datPath, "rb");
+    if (!dat) return 0;
+
+    fseek(dat, 0, SEEK_END);
+    long size = ftell(dat);
+    uint32_t total = size > SEG_HEADER_SIZE
+                   ? (uint32_t)((size - SEG_HEADER_SIZE) / SEG_RECORD_SIZE) : 0;
+
+    char idxPath[SEG_PATH_MAX + 32];
+    snprintf(idxPath, sizeof(idxPath), "%s", datPath);
+    size_t len = strlen(idxPath);
+    if (len > 3) strcpy(idxPath + len - 3, "idx");
+
+    uint32_t indexed = 0;
+    int stopped = 0;
+    FILE *idx = fopen(idxPath, "rb");
+    if (idx) {
+        unsigned char e[SEG_INDEX_SIZE];
+        while (!stopped && fread(e, 1, sizeof(e), idx) == sizeof(e)) {
+            SegBlock b;
+            segGetBlock(e, &b);
+            if (b.first + b.count > indexed) indexed = b.first + b.count;
+
+            if (b.maxMs < q->fromMs || b.minMs > q->toMs) continue;
+            if (q->nodeId >= 0 && !(b.nodeMask & segNodeBit((uint32_t)q->nodeId)))
+                continue;
+            stopped = segScanRange(dat, b.first, b.count, q);
+        }
+        fclose(idx);
+    }
+
+    if (!stopped && indexed < total)
+        stopped = segScanRange(dat, indexed, total - indexed, q);
+
+    fclose(dat);
+    return stopped;
+}
+
+static inline int segCmpName(const void *a, const void *b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* ---------- LIST FILES ----------
+ * Returns a malloc'd array of malloc'd "dir/name" paths for names
+ * starting with prefix and ending with suffix, sorted by name.
+ */
+static inline char **listFiles(const char *dir, const char *prefix,
+                               const char *suffix, int *count) {
+    char **names = NULL;
+    int n = 0, cap = 0;
+    *count = 0;
+
+#ifdef _WIN32
+    char pattern[SEG_PATH_MAX + 16];
+    snprintf(pattern, sizeof(pattern), "%s\\%s*%s", dir, prefix, suffix);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    if (h == INVALID_HANDLE_VALUE) return NULL;
+    do {
+        const char *name = fd.cFileName;
+#else
+    size_t pre = strlen(prefix), suf = strlen(suffix);
+    DIR *d = opendir(dir);
+    if (!d) return NULL;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        size_t len = strlen(name);
+        if (len <= pre + suf || strncmp(name, prefix, pre) != 0 ||
+            strcmp(name + len - suf, suffix) != 0)
+            continue;
+#endif
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            char **p = realloc(names, cap * sizeof(char*));
+            if (!p) break;
+            names = p;
+        }
+        size_t size = strlen(dir) + strlen(name) + 2;
+        names[n] = malloc(size);
+        if (!names[n]) break;
+        snprintf(names[n], size, "%s/%s", dir, name);
+        n++;
+#ifdef _WIN32
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    }
+    closedir(d);
+#endif
+
+    if (n > 1) qsort(names, n, sizeof(char*), segCmpName);
+    *count = n;
+    return names;
+}
+
+static inline void listFree(char **names, int count) {
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+/* ---------- LIST SEGMENTS ----------
+ * .dat paths in time order.
+ */
+static inline char **segList(const char *dir, int *count) {
+    return listFiles(dir, "seg-", ".dat", count);
+}
+
+static inline void segListFree(char **names, int count) {
+    listFree(names, count);
+}
+
+/* ---------- RETENTION ----------
+ * Deletes segments beyond the newest keepFiles and any last written
+ * more than keepDays ago; 0 turns a limit off. The .dat goes first,
+ * so a reader never finds a segment without its index. The open
+ * segment always stays. Returns the number removed.
+ */
+static inline int segRetain(SegWriter *w, int keepFiles, int keepDays) {
+    if (keepFiles <= 0 && keepDays <= 0) return 0;
+
+    int n, removed = 0;
+    char **names = segList(w->dir, &n);
+    time_t cutoff = keepDays > 0 ? time(NULL) - (time_t)keepDays * 86400 : 0;
+
+    for (int i = 0; i < n; i++) {
+        struct stat st;
+        int excess = keepFiles > 0 && n - i > keepFiles;
+        int expired = cutoff && stat(names[i], &st) == 0 && st.st_mtime < cutoff;
+        if (!(excess || expired) || strcmp(names[i], w->path) == 0) continue;
+        if (remove(names[i]) != 0) continue;
+
+        strcpy(names[i] + strlen(names[i]) - 3, "idx");
+        remove(names[i]);
+        removed++;
+    }
+    segListFree(names, n);
+    return removed;
+}
+
+/* ---------- QUERY DIRECTORY ----------
+ * Visits every matching record, segment by segment. Batched v2
+ * readings can carry times older than their segment's name, so
+ * every sidecar index is consulted rather than trusting names.
+ */
+static inline void segQueryDir(const char *dir, const SegQuery *q) {
+    int n;
+    char **names = segList(dir, &n);
+
+    for (int i = 0; i < n; i++)
+        if (segQueryFile(names[i], q)) break;
+    segListFree(names, n);
+}
+
+#endif
@@ -0,0 +1,252 @@
+/* ================= SEGMENT READER =================
+   Reads the server's binary segment log (segment.h) with positioned
+   reads into one small reusable buffer, so a request costs memory in
+   proportion to its result, not to the history on disk.
+
+   - latest(limit, node) walks segments and blocks newest first and
+     stops once it has `limit` readings.
+   - range(node, fromMs, toMs, visit) reads only the blocks whose
+     time span and node mask can match.
+   - nodeStats() / overview() keep running per-node aggregates; only
+     records appended since the previous call are read. */
+const fs = require("fs");
+const path = require("path");
+const { NodeStats, formatTime } = require("./nodeStats");
+
+const HEADER_SIZE = 16;
+const RECORD_SIZE = 24;
+const INDEX_SIZE = 32;
+const BLOCK = 256;
+
+const EVENTS = { 1: "DATA", 2: "REGISTER", 3: "RECONNECT", 4: "DISCONNECT", 5: "UNKNOWN",
+                 6: "POLICY", 7: "ALERT" };
+
+const blockBuf = Buffer.alloc(BLOCK * RECORD_SIZE);
+
+/* ---------- HELPERS ---------- */
+function readU64(buf, off) {
+  return buf.readUInt32LE(off) + buf.readUInt32LE(off + 4) * 0x100000000;
+}
+
+function decodeRecord(buf, off) {
+  return {
+    timeMs: readU64(buf, off),
+    node: buf.readUInt32LE(off + 8),
+    event: EVENTS[buf[off + 12]] || "UNKNOWN",
+    temperature: buf.readInt16LE(off + 14) / 100,
+    humidity: buf.readUInt16LE(off + 16) / 100,
+    soil: buf.readUInt16LE(off + 18),
+    water: buf.readUInt16LE(off + 20)
+  };
+}
+
+function toReading(r) {
+  return {
+    time: formatTime(r.timeMs),
+    node: r.node,
+    temperature: r.temperature,
+    humidity: r.humidity,
+    soil: r.soil,
+    water: r.water
+  };
+}
+
+function recordCount(size) {
+  return size > HEADER_SIZE ? Math.floor((size - HEADER_SIZE) / RECORD_SIZE) : 0;
+}
+
+/* Reads records [first, first+count) of an open segment, in chunks of
+   one block, calling visit(record) for each; visit returns true to stop. */
+function scanRecords(fd, first, count, visit, reverse = false) {
+  let done = 0;
+  while (done < count) {
+    const n = Math.min(BLOCK, count - done);
+    const start = reverse ? first + count - done - n : first + done;
+    const got = fs.readSync(fd, blockBuf, 0, n * RECORD_SIZE,
+                            HEADER_SIZE + start * RECORD_SIZE) / RECORD_SIZE;
+    for (let i = 0; i < got; i++) {
+      const k = reverse ? got - 1 - i : i;
+      if (visit(decodeRecord(blockBuf, k * RECORD_SIZE))) return true;
+    }
+    if (got < n) break;
+    done += n;
+  }
+  return false;
+}
+
+/* Sidecar index entries for one segment: [{ minMs, maxMs, first, count, nodeMask }]. */
+function readIndex(datPath) {
+  let buf;
+  try {
+    buf = fs.readFileSync(datPath.slice(0, -3) + "idx");
+  } catch (err) {
+    return [];
+  }
+  const blocks = [];
+  for (let off = 0; off + INDEX_SIZE <= buf.length; off += INDEX_SIZE) {
+    blocks.push({
+      minMs: readU64(buf, off),
+      maxMs: readU64(buf, off + 8),
+      first: buf.readUInt32LE(off + 16),
+      count: buf.readUInt32LE(off + 20),
+      nodeMask: buf.readBigUInt64LE(off + 24)
+    });
+  }
+  return blocks;
+}
+
+/* ---------- SEGMENT READER ---------- */
+class SegmentReader {
+  constructor(dir) {
+    this.dir = dir;
+    this.resetStats();
+  }
+
+  available() {
+    return this.segments().length > 0;
+  }
+
+  segments() {
+    try {
+      return fs.readdirSync(this.dir)
+        .filter(name => name.startsWith("seg-") && name.endsWith(".dat"))
+        .sort()
+        .map(name => path.join(this.dir, name));
+    } catch (err) {
+      return [];
+    }
+  }
+
+  /* ---------- LATEST N READINGS ----------
+     Log order, oldest first, like slicing the tail of the text log. */
+  latest(limit = 50, node = null) {
+    const out = [];
+    const files = this.segments();
+
+    for (let f = files.length - 1; f >= 0 && out.length < limit; f--) {
+      let fd;
+      try {
+        fd = fs.openSync(files[f], "r");
+      } catch (err) {
+        continue;
+      }
+      try {
+        const total = recordCount(fs.fstatSync(fd).size);
+        const take = r => {
+          if (r.event === "DATA" && (node === null || r.node === node))
+            out.push(toReading(r));
+          return out.length >= limit;
+        };
+
+        if (node === null) {
+          scanRecords(fd, 0, total, take, true);
+        } else {
+          /* unindexed tail first, then only blocks that hold the node */
+          const blocks = readIndex(files[f]);
+          const bit = 1n << BigInt(node & 63);
+          const indexed = blocks.length
+            ? blocks[blocks.length - 1].first + blocks[blocks.length - 1].count : 0;
+          let stop = total > indexed && scanRecords(fd, indexed, total - indexed, take, true);
+          for (let b = blocks.length - 1; b >= 0 && !stop; b--) {
+            if (blocks[b].nodeMask & bit)
+              stop = scanRecords(fd, blocks[b].first, blocks[b].count, take, true);
+          }
+        }
+      } finally {
+        fs.closeSync(fd);
+      }
+    }
+    return out.reverse();
+  }
+
+  /* ---------- TIME RANGE ----------
+     Calls visit(reading) with time in unix ms for each DATA record of
+     `node` in [fromMs, toMs]. */
+  range(node, fromMs, toMs, visit) {
+    const bit = 1n << BigInt(node & 63);
+    const take = r => {
+      if (r.event === "DATA" && r.node === node && r.timeMs >= fromMs && r.timeMs <= toMs)
+        visit({ ...toReading(r), time: r.timeMs });
+    };
+
+    for (const file of this.segments()) {
+      let fd;
+      try {
+        fd = fs.openSync(file, "r");
+      } catch (err) {
+        continue;
+      }
+      try {
+        const total = recordCount(fs.fstatSync(fd).size);
+        const blocks = readIndex(file);
+        for (const b of blocks) {
+          if (b.maxMs >= fromMs && b.minMs <= toMs && (b.nodeMask & bit))
+            scanRecords(fd, b.first, b.count, take);
+        }
+        const indexed = blocks.length
+          ? blocks[blocks.length - 1].first + blocks[blocks.length - 1].count : 0;
+        if (total > indexed) scanRecords(fd, indexed, total - indexed, take);
+      } finally {
+        fs.closeSync(fd);
+      }
+    }
+  }
+
+  /* ---------- RUNNING AGGREGATES ---------- */
+  resetStats() {
+    this.scanned = new Map();     // segment path -> records already folded in
+    this.stats = new NodeStats();
+  }
+
+  /* Folds in whatever was appended since the last call. Starts over
+     if a segment it had read has gone away (rotation / retention). */
+  refresh() {
+    const files = this.segments();
+    const present = new Set(files);
+    for (const seen of this.scanned.keys()) {
+      if (!present.has(seen)) {
+        this.resetStats();
+        break;
+      }
+    }
+
+    for (const file of files) {
+      let fd;
+      try {
+        fd = fs.openSync(file, "r");
+      } catch (err) {
+        continue;
+      }
+      try {
+        const done = this.scanned.get(file) || 0;
+        const total = recordCount(fs.fstatSync(fd).size);
+        if (total > done) {
+          scanRecords(fd, done, total - done, r => {
+            this.stats.fold(r.event, r.node, {
+              time: r.timeMs,
+              temperature: r.temperature,
+              humidity: r.humidity,
+              soil: r.soil,
+              water: r.water
+            });
+          });
+          this.scanned.set(file, total);
+        }
+      } finally {
+        fs.closeSync(fd);
+      }
+    }
+  }
+
+  nodeStats() {
+    this.refresh();
+    return this.stats.list();
+  }
+
+  overview() {
+    this.refresh();
+    return this.stats.overview();
+  }
+}
+
+module.exports = { SegmentReader };
@@ -0,0 +1,225 @@
+/* ================= SEND POLICY =================
+ * Decides, sample by sample, whether a node transmits. Each sensor
+ * in sensorFields[] has its own row:
+ *
+ *   delta     send once the value is this far from the last one sent
+ *   deadband  sample-to-sample changes this small count as noise
+ *   rate      send while the smoothed change per minute is this steep
+ *
+ * plus maxSilenceMs, after which a reading goes out regardless.
+ * 0 turns a rule off. A quiet node sends once per maxSilenceMs; a
+ * water level that starts climbing trips `rate` within a sample or
+ * two and keeps every sample going out while it climbs.
+ *
+ * Rows come from options ("water-rate=8") and are replaced live by
+ * POLICY frames from the server (protocol.h). Both ends read the
+ * same key=value text through policyParse().
+ */
+#ifndef SENDPOLICY_H
+#define SENDPOLICY_H
+
+#include "protocol.h"
+#include "kvparse.h"
+#include <math.h>
+
+#define POLICY_DELTA      0
+#define POLICY_DEADBAND   1
+#define POLICY_RATE       2
+#define POLICY_RATE_ALPHA 0.5f          // EWMA weight of the newest slope
+#define POLICY_SILENCE_MS (2 * 60 * 1000)
+
+#if POLICY_METRICS != 4
+#error "POLICY_METRICS must match sensorFields[]"
+#endif
+
+static const char *policyParamNames[POLICY_PARAMS] = { "delta", "deadband", "rate" };
+
+/* Reading order. TEMP / HUM deltas are the old fixed thresholds;
+   WATER rate is per minute, soil and water in sensor units. */
+static const float policyDefaults[POLICY_METRICS][POLICY_PARAMS] = {
+    {  0.5f, 0.0f, 0.0f },      // TEMP
+    {  2.0f, 0.0f, 0.0f },      // HUM
+    { 10.0f, 1.0f, 0.0f },      // SOIL
+    { 10.0f, 1.0f, 6.0f },      // WATER
+};
+
+typedef struct {
+    float value[POLICY_METRICS][POLICY_PARAMS];
+    int maxSilenceMs;
+    uint32_t version;           // last POLICY frame applied, 0 = none
+} SendPolicy;
+
+typedef struct {
+    float sent[POLICY_METRICS];     // values in the last reading sent
+    float prev[POLICY_METRICS];     // previous sample
+    float rate[POLICY_METRICS];     // smoothed change per minute
+    uint64_t prevAt;
+    uint64_t sentAt;
+    int primed;
+} PolicyState;
+
+/* why a sample was sent; SEND_NONE = held back */
+enum { SEND_NONE, SEND_FIRST, SEND_SILENCE, SEND_DELTA, SEND_RATE };
+
+static inline void policyDefault(SendPolicy *p) {
+    memcpy(p->value, policyDefaults, sizeof(p->value));
+    p->maxSilenceMs = POLICY_SILENCE_MS;
+    p->version = 0;
+}
+
+/* ---------- DECIDE ---------- */
+static inline void policyValues(const Reading *r, float v[POLICY_METRICS]) {
+    for (int m = 0; m < POLICY_METRICS; m++) {
+        const char *slot = (const char*)r + sensorFields[m].offset;
+        v[m] = sensorFields[m].isFloat ? *(const float*)slot : (float)*(const int*)slot;
+    }
+}
+
+static inline int policyDecide(const SendPolicy *p, PolicyState *st,
+                               const Reading *r, uint64_t now) {
+    float v[POLICY_METRICS];
+    policyValues(r, v);
+
+    if (!st->primed) {
+        memcpy(st->prev, v, sizeof(v));
+        memset(st->rate, 0, sizeof(st->rate));
+        st->prevAt = now;
+        st->primed = 1;
+        return SEND_FIRST;
+    }
+
+    float minutes = (float)(now - st->prevAt) / 60000.0f;
+    for (int m = 0; m < POLICY_METRICS; m++) {
+        float d = v[m] - st->prev[m];
+        if (fabsf(d) <= p->value[m][POLICY_DEADBAND]) d = 0;
+        if (minutes > 0)
+            st->rate[m] += POLICY_RATE_ALPHA * (d / minutes - st->rate[m]);
+        st->prev[m] = v[m];
+    }
+    st->prevAt = now;
+
+    if (p->maxSilenceMs > 0 && now - st->sentAt >= (uint64_t)p->maxSilenceMs)
+        return SEND_SILENCE;
+    for (int m = 0; m < POLICY_METRICS; m++) {
+        float rate = p->value[m][POLICY_RATE];
+        if (rate > 0 && fabsf(st->rate[m]) >= rate) return SEND_RATE;
+    }
+    for (int m = 0; m < POLICY_METRICS; m++) {
+        float delta = p->value[m][POLICY_DELTA];
+        if (delta > 0 && fabsf(v[m] - st->sent[m]) >= delta) return SEND_DELTA;
+    }
+    return SEND_NONE;
+}
+
+/* Call once the sample that policyDecide() let through is sent. */
+static inline void policySent(PolicyState *st, const Reading *r, uint64_t now) {
+    policyValues(r, st->sent);
+    st->sentAt = now;
+}
+
+/* ---------- KEYS ----------
+ * "<sensor>-<param>" or "<sensor>.<param>", any case, e.g.
+ * water-rate, SOIL.delta; "<sensor>-threshold" is the old name for
+ * delta. max-silence-ms (alias send-interval-ms) sets the quiet
+ * period.
+ */
+static inline int policyNameIs(const char *s, int len, const char *name) {
+    int i = 0;
+    for (; i < len && name[i]; i++) {
+        char c = s[i] >= 'A' && s[i] <= 'Z' ? (char)(s[i] + 32) : s[i];
+        char n = name[i] >= 'A' && name[i] <= 'Z' ? (char)(name[i] + 32) : name[i];
+        if (c != n) return 0;
+    }
+    return i == len && name[i] == '\0';
+}
+
+/* Stores one key into u; returns 0 if the key is not a policy key. */
+static inline int policySetKey(PolicyUpdate *u, const char *key, int len, double v) {
+    if (policyNameIs(key, len, "max-silence-ms") || policyNameIs(key, len, "send-interval-ms")) {
+        u->maxSilenceMs = v < 0 ? 0 : (uint32_t)v;
+        u->mask |= POLICY_SILENCE;
+        return 1;
+    }
+
+    int sep = 0;
+    while (sep < len && key[sep] != '-' && key[sep] != '.') sep++;
+    if (sep == len) return 0;
+
+    const char *param = key + sep + 1;
+    int plen = len - sep - 1;
+    for (int m = 0; m < POLICY_METRICS; m++) {
+        if (!policyNameIs(key, sep, sensorFields[m].key)) continue;
+        for (int k = 0; k < POLICY_PARAMS; k++) {
+            if (policyNameIs(param, plen, policyParamNames[k]) ||
+                (k == POLICY_DELTA && policyNameIs(param, plen, "threshold"))) {
+                u->value[m][k] = v < 0 ? 0 : (float)v;
+                u->mask |= (uint16_t)(1 << (m * POLICY_PARAMS + k));
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Parses "water-rate=8 soil-delta=5 ..." into u (cleared first).
+   Returns the number of keys set, -1 on an unknown key or a value
+   that is not a number. */
+static inline int policyParse(const char *text, size_t len, PolicyUpdate *u) {
+    KvField f[KV_MAX_FIELDS];
+    int n = kvParse(text, len, f, KV_MAX_FIELDS);
+
+    memset(u, 0, sizeof(*u));
+    for (int i = 0; i < n; i++)
+        if (!f[i].isNum || !policySetKey(u, f[i].key, f[i].keyLen, f[i].num))
+            return -1;
+    return n;
+}
+
+static inline void policyApply(SendPolicy *p, const PolicyUpdate *u) {
+    for (int m = 0; m < POLICY_METRICS; m++)
+        for (int k = 0; k < POLICY_PARAMS; k++)
+            if (u->mask & (1 << (m * POLICY_PARAMS + k)))
+                p->value[m][k] = u->value[m][k];
+    if (u->mask & POLICY_SILENCE)
+        p->maxSilenceMs = (int)u->maxSilenceMs;
+}
+
+/* Later values win. */
+static inline void policyMerge(PolicyUpdate *into, const PolicyUpdate *u) {
+    for (int m = 0; m < POLICY_METRICS; m++)
+        for (int k = 0; k < POLICY_PARAMS; k++)
+            if (u->mask & (1 << (m * POLICY_PARAMS + k)))
+                into->value[m][k] = u->value[m][k];
+    if (u->mask & POLICY_SILENCE)
+        into->maxSilenceMs = u->maxSilenceMs;
+    into->mask |= u->mask;
+}
+
+/* "water-rate=8 max-silence-ms=60000", the set keys only. */
+static inline int policyDescribe(const PolicyUpdate *u, char *out, size_t size) {
+    size_t used = 0;
+    if (size) out[0] = '\0';
+    for (int m = 0; m < POLICY_METRICS; m++) {
+        for (int k = 0; k < POLICY_PARAMS; k++) {
+            if (!(u->mask & (1 << (m * POLICY_PARAMS + k)))) continue;
+            char name[16];
+            int i = 0;
+            for (; sensorFields[m].key[i] && i < 15; i++)
+                name[i] = (char)(sensorFields[m].key[i] | 0x20);   // keys are A-Z
+            name[i] = '\0';
+
+            int w = snprintf(out + used, size - used, "%s%s-%s=%g", used ? " " : "",
+                             name, policyParamNames[k], u->value[m][k]);
+            if (w < 0 || (size_t)w >= size - used) return (int)used;
+            used += (size_t)w;
+        }
+    }
+    if (u->mask & POLICY_SILENCE) {
+        int w = snprintf(out + used, size - used, "%smax-silence-ms=%u",
+                         used ? " " : "", u->maxSilenceMs);
+        if (w > 0 && (size_t)w < size - used) used += (size_t)w;
+    }
+    return (int)used;
+}
+
+#endif
@@ -1,6 +1,12 @@
 import React, { useEffect, useState } from "react";
 import { LineChart, Line, XAxis, YAxis, CartesianGrid, Tooltip, Legend, ResponsiveContainer, BarChart, Bar, ReferenceLine, Area, AreaChart } from "recharts";
 
+const HISTORY_ROWS = 50;
+const RECENT_ROWS = 10;
+const CHART_HOURS = 24;
+const CHART_POINTS = 500;
+const ROLLUP_REFRESH_MS = 10000;
+
 export default function Dashboard() {
   const [allData, setAllData] = useState([]);
   const [recentData, setRecentData] = useState([]);
@@ -9,64 +15,120 @@ export default function Dashboard() {
   const [selectedNode, setSelectedNode] = useState(null);
   const [viewMode, setViewMode] = useState("overview");
   const [floodAlerts, setFloodAlerts] = useState({});
+  const [rollups, setRollups] = useState({});
 
   useEffect(() => {
-    const fetchData = async () => {
-      try {
-        const allRes = await fetch("http://localhost:5000/api/sensor-data");
-        const allSensorData = await allRes.json();
-
-        const recentRes = await fetch("http://localhost:5000/api/sensor-data?limit=10");
-        const recentSensorData = await recentRes.json();
-
-        const nodeRes = await fetch("http://localhost:5000/api/nodes");
-        const nodeStats = await nodeRes.json();
-
-        setAllData(allSensorData);
-        setRecentData(recentSensorData);
-        setLastUpdate(new Date());
-
-        const nodeMap = {};
-        allSensorData.forEach(d => {
-          if (!nodeMap[d.node]) {
-            nodeMap[d.node] = {
-              id: d.node,
-              readings: [],
-              lastSeen: d.time,
-              backendStatus: "online"
-            };
-          }
-          nodeMap[d.node].readings.push(d);
-          nodeMap[d.node].lastSeen = d.time;
-        });
-
-        nodeStats.forEach(n => {
-          if (!nodeMap[n.id]) {
-            nodeMap[n.id] = {
-              id: n.id,
-              readings: [],
-              lastSeen: n.lastSeen
-            };
-          }
-          nodeMap[n.id].backendStatus = n.status;
-          nodeMap[n.id].lastEvent = n.lastEvent;
-        });
-
-        setNodes(nodeMap);
-        calculateFloodAlerts(nodeMap);
-      } catch (err) {
-        console.error(err);
-      }
+    /* Live stream from the API: one snapshot, then deltas with new
+       readings and node status changes. EventSource reconnects on
+       its own and every reconnect starts with a fresh snapshot. */
+    let allSensorData = [];
+    let nodeStats = {};
+    let serverFlood = {};
+
+    const publish = () => {
+      setAllData(allSensorData);
+      setRecentData(allSensorData.slice(-RECENT_ROWS));
+      setLastUpdate(new Date());
+
+      const nodeMap = {};
+      allSensorData.forEach(d => {
+        if (!nodeMap[d.node]) {
+          nodeMap[d.node] = {
+            id: d.node,
+            readings: [],
+            lastSeen: d.time,
+            backendStatus: "online"
+          };
+        }
+        nodeMap[d.node].readings.push(d);
+        nodeMap[d.node].lastSeen = d.time;
+      });
+
+      Object.values(nodeStats).forEach(n => {
+        if (!nodeMap[n.id]) {
+          nodeMap[n.id] = {
+            id: n.id,
+            readings: [],
+            lastSeen: n.lastSeen
+          };
+        }
+        nodeMap[n.id].backendStatus = n.status;
+        nodeMap[n.id].lastEvent = n.lastEvent;
+      });
+
+      setNodes(nodeMap);
+      calculateFloodAlerts(nodeMap, serverFlood);
     };
 
-    fetchData();
-    const timer = setInterval(fetchData, 5000);
-    return () => clearInterval(timer);
+    const source = new EventSource(`http://localhost:5000/api/stream?limit=${HISTORY_ROWS}`);
+
+    source.addEventListener("snapshot", e => {
+      const snap = JSON.parse(e.data);
+      allSensorData = snap.sensorData;
+      nodeStats = {};
+      snap.nodes.forEach(n => { nodeStats[n.id] = n; });
+      serverFlood = {};
+      (snap.flood || []).forEach(f => { serverFlood[f.node] = f; });
+      publish();
+    });
+
+    source.addEventListener("delta", e => {
+      const delta = JSON.parse(e.data);
+      if (delta.readings.length) {
+        allSensorData = allSensorData.concat(delta.readings).slice(-HISTORY_ROWS);
+      }
+      delta.nodes.forEach(n => { nodeStats[n.id] = n; });
+      publish();
+    });
+
+    /* pushed by the server the moment a reading changes a node's
+       flood level or flash flood state */
+    source.addEventListener("alert", e => {
+      const alert = JSON.parse(e.data);
+      serverFlood[alert.node] = alert;
+      publish();
+    });
+
+    source.onerror = err => console.error(err);
+    return () => source.close();
   }, []);
 
-  const calculateFloodAlerts = (nodeMap) => {
+  useEffect(() => {
+    /* Charts use the API's pre-aggregated buckets for the selected
+       node, refreshed on a timer rather than on every reading. */
+    if (!selectedNode) return;
+    let cancelled = false;
+
+    const load = () =>
+      fetch(`http://localhost:5000/api/nodes/${selectedNode}/rollup?hours=${CHART_HOURS}&points=${CHART_POINTS}`)
+        .then(res => res.json())
+        .then(r => {
+          if (!cancelled && r.points) setRollups(prev => ({ ...prev, [selectedNode]: r }));
+        })
+        .catch(err => console.error(err));
+
+    load();
+    const timer = setInterval(load, ROLLUP_REFRESH_MS);
+    return () => { cancelled = true; clearInterval(timer); };
+  }, [selectedNode]);
+
+  /* The server evaluates the flood rules on every reading (flood.h);
+     without it (log-only mode) they are worked out here from the
+     readings the dashboard has. */
+  const calculateFloodAlerts = (nodeMap, serverFlood) => {
     const alerts = {};
     Object.values(nodeMap).forEach(node => {
+      const server = serverFlood[node.id];
+      if (server) {
+        alerts[node.id] = {
+          level: server.level,
+          riskIndex: server.riskIndex,
+          changeRate: server.changeRate,
+          isFlashFlood: server.isFlashFlood
+        };
+        return;
+      }
+
       const reading = getLatestReading(node);
       if (reading) {
         const floodRiskIndex = (reading.water * 0.5) + (reading.soil * 0.3) + (reading.humidity * 0.2);
@@ -109,7 +171,32 @@ export default function Dashboard() {
     return node.readings[node.readings.length - 1];
   };
 
-  const getChartData = (nodeId, hours = 24) => {
+  const chartLabel = (ms) => new Date(ms).toLocaleString('en-US', {
+    month: 'short',
+    day: 'numeric',
+    hour: '2-digit',
+    minute: '2-digit'
+  });
+
+  const getChartData = (nodeId, hours = CHART_HOURS) => {
+    /* one point per rollup bucket (bucket averages) when loaded */
+    const rollup = rollups[nodeId];
+    if (rollup && hours === CHART_HOURS) {
+      return rollup.points.map(b => {
+        const avg = m => Number((b[m].sum / b.count).toFixed(2));
+        const d = {
+          timestamp: b.time,
+          time: chartLabel(b.time),
+          water: avg("water"),
+          humidity: avg("humidity"),
+          soil: avg("soil"),
+          temperature: avg("temperature")
+        };
+        d.floodRisk = (d.water * 0.5) + (d.soil * 0.3) + (d.humidity * 0.2);
+        return d;
+      });
+    }
+
     const nodeData = nodes[nodeId]?.readings || [];
     const now = new Date();
     const hoursAgo = new Date(now.getTime() - hours * 60 * 60 * 1000);
@@ -123,12 +210,7 @@ export default function Dashboard() {
         const readingTime = new Date(d.time.replace(" ", "T"));
         return {
           timestamp: readingTime.getTime(),
-          time: readingTime.toLocaleString('en-US', { 
-            month: 'short', 
-            day: 'numeric', 
-            hour: '2-digit', 
-            minute: '2-digit' 
-          }),
+          time: chartLabel(readingTime.getTime()),
           water: d.water,
           humidity: d.humidity,
           soil: d.soil,
@@ -0,0 +1,113 @@
+/* ================= SEQUENCE TRACKING =================
+ * Loss, reorder and duplicate accounting over the per-node sequence
+ * numbers nodes stamp on readings (v2 frame seq, v1 SEQ= field).
+ * State is constant per node: the highest sequence seen plus a
+ * 64-bit window of which of the sequences just below it arrived,
+ * the same sliding window IPsec/DTLS use against replays.
+ *
+ *   ahead of highest   k skipped      lost += k, window slides
+ *   inside the window  bit set        duplicate, caller drops it
+ *                      bit clear      reordered, lost -= 1
+ *   behind the window                 late: accepted, lost -= 1
+ *   far behind                        node restarted, new baseline
+ *
+ * A late reading might also be a duplicate; past the window there is
+ * no way to tell, so it is kept.
+ */
+#ifndef SEQTRACK_H
+#define SEQTRACK_H
+
+#include <stdint.h>
+
+#define SEQ_WINDOW  64
+#define SEQ_RESTART 4096        // a jump back this far means a restart
+
+typedef struct {
+    int started;
+    uint32_t highest;
+    uint32_t base;              // first sequence since (re)start
+    uint64_t window;            // bit k: highest - k has arrived
+
+    uint64_t received;
+    uint64_t lost;              // skipped and not (yet) seen
+    uint64_t reordered;
+    uint64_t duplicates;
+    uint64_t late;
+    uint64_t restarts;
+} SeqTrack;
+
+/* Forget the baseline (node re-registered), keep the counters. */
+static inline void seqReset(SeqTrack *t) {
+    if (t->started) t->restarts++;
+    t->started = 0;
+}
+
+/* Returns 1 to accept the reading, 0 for a duplicate. */
+static inline int seqCheck(SeqTrack *t, uint32_t seq) {
+    if (!t->started) {
+        t->started = 1;
+        t->highest = seq;
+        t->base = seq;
+        t->window = 1;
+        t->received++;
+        return 1;
+    }
+
+    int32_t diff = (int32_t)(seq - t->highest);
+
+    if (diff > 0) {
+        t->lost += (uint64_t)(diff - 1);
+        t->window = diff >= SEQ_WINDOW ? 1 : (t->window << diff) | 1;
+        t->highest = seq;
+        t->received++;
+        return 1;
+    }
+
+    uint32_t back = (uint32_t)-(int64_t)diff;
+    if (back < SEQ_WINDOW) {
+        uint64_t bit = 1ULL << back;
+        if (t->window & bit) {
+            t->duplicates++;
+            return 0;
+        }
+        t->window |= bit;
+        t->reordered++;
+    } else if (back >= SEQ_RESTART) {
+        seqReset(t);
+        return seqCheck(t, seq);
+    } else {
+        t->late++;
+    }
+    if (t->lost) t->lost--;
+    t->received++;
+    return 1;
+}
+
+/* ---------- ACK STATE ----------
+ * What a selective ACK should say (protocol.h FRAME_ACK): cum is the
+ * oldest sequence still missing inside the window, or highest + 1,
+ * and bit k of sack is set when cum + 1 + k has arrived. Anything
+ * that fell out of the window counts as received; the sender's
+ * retransmit window is no larger than ours.
+ */
+static inline void seqAck(const SeqTrack *t, uint32_t *cum, uint64_t *sack) {
+    *sack = 0;
+    if (!t->started) {
+        *cum = 0;
+        return;
+    }
+
+    uint32_t span = t->highest - t->base;
+    int k = span < SEQ_WINDOW ? (int)span : SEQ_WINDOW - 1;
+    while (k >= 0 && (t->window >> k & 1)) k--;
+
+    if (k < 0) {
+        *cum = t->highest + 1;
+        return;
+    }
+    *cum = t->highest - (uint32_t)k;
+    for (int j = 0; j < k; j++)
+        if (t->window >> (k - 1 - j) & 1) *sack |= 1ULL << j;
+}
+
+#endif
@@ -0,0 +1,162 @@
+/* ================= SERIAL INPUT =================
+ * Line reader for the Arduino's "TEMP:23.5,HUM:61" output. The port
+ * is opened raw and non-blocking; serialFill() moves whatever the
+ * driver holds into a ring buffer a chunk per read(), and
+ * serialLine() hands back complete lines, found with memchr.
+ *
+ * On POSIX the fd goes into the client's Poller, so a reading is
+ * forwarded as soon as its '\n' arrives. Windows comm handles cannot
+ * be select()ed; there reads return at once (COMMTIMEOUTS) and the
+ * event loop checks the port every SERIAL_POLL_MS.
+ *
+ * Any tty will do, so a pty can stand in for the board.
+ */
+#ifndef SERIALPORT_H
+#define SERIALPORT_H
+
+#include "platform.h"
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+#define SERIAL_RING     4096            // power of two
+#define SERIAL_LINE_MAX 256
+#define SERIAL_POLL_MS  10              // Windows only
+#define SERIAL_RETRY_MS 3000
+
+#ifdef _WIN32
+#define SERIAL_POLLABLE 0
+#else
+#define SERIAL_POLLABLE 1
+#endif
+
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+    int open;
+    char ring[SERIAL_RING];
+    size_t head, tail;                  // free running; head - tail bytes held
+    unsigned long overflows;            // over-long lines dropped
+} SerialPort;
+
+/* ---------- OPEN (9600 8N1, raw) ---------- */
+static inline int serialOpen(SerialPort *sp, const char *path) {
+    sp->head = sp->tail = 0;
+#ifdef _WIN32
+    sp->handle = CreateFile(path, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (sp->handle == INVALID_HANDLE_VALUE)
+        return 0;
+
+    DCB dcb = {0};
+    dcb.DCBlength = sizeof(dcb);
+    GetCommState(sp->handle, &dcb);
+    dcb.BaudRate = CBR_9600;
+    dcb.ByteSize = 8;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.Parity   = NOPARITY;
+    SetCommState(sp->handle, &dcb);
+
+    /* return immediately with whatever has arrived */
+    COMMTIMEOUTS to = {0};
+    to.ReadIntervalTimeout = MAXDWORD;
+    SetCommTimeouts(sp->handle, &to);
+#else
+    sp->fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    if (sp->fd < 0)
+        return 0;
+
+    struct termios tio;
+    if (tcgetattr(sp->fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B9600);
+        cfsetospeed(&tio, B9600);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(sp->fd, TCSANOW, &tio);
+    }
+#endif
+    sp->open = 1;
+    return 1;
+}
+
+static inline void serialClose(SerialPort *sp) {
+    if (!sp->open) return;
+#ifdef _WIN32
+    CloseHandle(sp->handle);
+#else
+    close(sp->fd);
+#endif
+    sp->open = 0;
+}
+
+/* ---------- FILL ----------
+ * Reads until the driver is empty or the ring is full. Returns bytes
+ * read, 0 if there was nothing, -1 once the port is gone (unplugged,
+ * pty closed).
+ */
+static inline int serialFill(SerialPort *sp) {
+    size_t total = 0;
+
+    while (sp->head - sp->tail < SERIAL_RING) {
+        size_t used = sp->head - sp->tail;
+        size_t at = sp->head & (SERIAL_RING - 1);
+        size_t room = SERIAL_RING - used;
+        if (room > SERIAL_RING - at) room = SERIAL_RING - at;
+#ifdef _WIN32
+        DWORD got;
+        if (!ReadFile(sp->handle, sp->ring + at, (DWORD)room, &got, NULL))
+            return total ? (int)total : -1;
+        if (got == 0) break;
+#else
+        ssize_t got = read(sp->fd, sp->ring + at, room);
+        if (got == 0)
+            return total ? (int)total : -1;
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return total ? (int)total : -1;
+        }
+#endif
+        sp->head += (size_t)got;
+        total += (size_t)got;
+    }
+    return (int)total;
+}
+
+/* ---------- NEXT LINE ----------
+ * Copies the next complete line (without "\r\n") to out, truncated
+ * to size - 1. Returns its length, -1 if no full line is buffered.
+ */
+static inline int serialLine(SerialPort *sp, char *out, size_t size) {
+    size_t used = sp->head - sp->tail;
+    size_t at = sp->tail & (SERIAL_RING - 1);
+    size_t first = used < SERIAL_RING - at ? used : SERIAL_RING - at;
+
+    size_t len;
+    const char *nl = memchr(sp->ring + at, '\n', first);
+    if (nl) {
+        len = (size_t)(nl - (sp->ring + at));
+    } else if (used > first && (nl = memchr(sp->ring, '\n', used - first))) {
+        len = first + (size_t)(nl - sp->ring);
+    } else {
+        if (used == SERIAL_RING) {      // no newline in a full ring
+            sp->tail = sp->head;
+            sp->overflows++;
+        }
+        return -1;
+    }
+
+    size_t copy = len < size - 1 ? len : size - 1;
+    size_t part = copy < SERIAL_RING - at ? copy : SERIAL_RING - at;
+    memcpy(out, sp->ring + at, part);
+    memcpy(out + part, sp->ring, copy - part);
+    if (copy && out[copy - 1] == '\r') copy--;
+    out[copy] = '\0';
+
+    sp->tail += len + 1;
+    return (int)copy;
+}
+
+#endif
@@ -1,217 +1,1372 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <winsock2.h>
-#include <windows.h>
+/* Build:
+ *   Windows (MinGW): gcc server.c -o server.exe -lws2_32
+ *   Linux:           gcc -O2 server.c -o server -lpthread
+ *   Add -DLOG_GZIP -lz to gzip rotated logs (logrotate.h).
+ */
+#include "platform.h"
+#include "registry.h"
+#include "logger.h"
+#include "protocol.h"
+#include "timerwheel.h"
+#include "tsstore.h"
+#include "query.h"
+#include "kvparse.h"
+#include "metrics.h"
+#include "sendpolicy.h"
+#include "alerts.h"
 #include <time.h>
 
-#pragma comment(lib,"ws2_32.lib")
-
 #define SERVER_PORT 8888
-#define BUFFER_SIZE 1024
-#define MAX_CLIENTS 10
+#define BUFFER_SIZE MAX_DATAGRAM
 #define CLIENT_TIMEOUT 15   // seconds
+#define TICK_MS 100         // disconnect detection precision
+
+#define MAX_WORKERS 64
+#define POLICY_RESEND_MS 2000
 
+/* ---------- INGEST WORKER ----------
+ * Each worker owns one SO_REUSEPORT socket and the shard of nodes
+ * whose packets the kernel steers to it (hashed on source address).
+ * Liveness runs on the worker's own timer wheel, so the shard lock
+ * is only shared with another worker when a node moves to a new
+ * source port.
+ *
+ * Lookups and heartbeats do not take the shard lock at all (see
+ * registry.h); it guards structural changes, series and the wheel.
+ */
 typedef struct {
-    struct sockaddr_in addr;
-    int registered;
-    int nodeId;
-    time_t lastSeen;
-    int active;
-} Client;
+    int id;
+    sock_t sock;
+    Registry reg;
+    TimerWheel wheel;
+    Mutex cs;
+    PacketBatch batch;
+    PacketBatch acks;               // one ACK per node per receive batch
+    int ackNode[RECV_BATCH];
+    Metrics *m;                     // this worker's counters (metrics.h)
+    unsigned long debugTick;
+} Worker;
 
-Client clients[MAX_CLIENTS];
-int clientCount = 0;
-CRITICAL_SECTION cs;
+Worker *workers;
+int workerCount = 1;
+int fsyncMs = LOG_FSYNC_MS;
+int tickMs = TICK_MS;
+int queryPort = QUERY_PORT;
+const char *segmentDir = SEG_DIR;
+long segmentBytes = SEG_MAX_BYTES;
+long rotateMb = -1, rotateHours = -1;
+int keepFiles = -1, keepDays = -1;
+atomic_ulong malformedFrames;
+int statsPort = STATS_PORT;
+int alertPort = ALERT_PORT;
+int debugSample = 0;        // print one packet in N, 0 = none
 
-/* ---------- GET TIMESTAMP ---------- */
-void getTimestamp(char *timeBuf, int size) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(timeBuf, size, "%Y-%m-%d %H:%M:%S", t);
+/* ---------- SEND POLICY DOWNLINK ----------
+ * What the server wants a node's send policy (sendpolicy.h) to be:
+ * every POLICY command aimed at it, merged. Each command gets a new
+ * version; the node answers a POLICY frame with the version it has
+ * applied, and until it does the frame goes out again whenever the
+ * node is heard from (at most every POLICY_RESEND_MS). Only v2 nodes
+ * read the downlink; for a v1 node the policy just stays pending.
+ */
+typedef struct NodePolicy {
+    PolicyUpdate want;
+    uint32_t version;
+    uint64_t sentAt;
+} NodePolicy;
+
+Mutex policyCs;             // taken after a shard lock, never before
+PolicyUpdate policyAll;     // every POLICY * so far, for nodes seen later
+atomic_uint policyVersion;
+
+/* ---------- DEBUG OUTPUT ----------
+ * Per-packet console lines are off unless --debug-sample N asks for
+ * one in N: a printf to the terminal costs more than the packet.
+ */
+int debugPacket(Worker *w) {
+    return debugSample > 0 && ++w->debugTick % (unsigned long)debugSample == 0;
 }
 
-/* ---------- LOG TO FILE ---------- */
-void logToFile(int nodeId, const char *eventType, const char *data) {
-    FILE *fp = fopen("server_log.txt", "a");
-    if (!fp) return;
+/* ---------- FIND CLIENT ----------
+ * The lookups every incoming datagram pays; timed into H_REGISTRY.
+ * Lock-free; only a miss is repeated under the shard lock, where it
+ * is exact. Call without the lock held.
+ */
+int findClientByAddr(Worker *w, struct sockaddr_in *addr) {
+    uint64_t t = monoNs();
+    int idx = registryFindAddr(&w->reg, addr);
+    if (idx == -1) {
+        mutexLock(&w->cs);
+        idx = registryFindAddr(&w->reg, addr);
+        mutexUnlock(&w->cs);
+    }
+    histSince(w->m, H_REGISTRY, t);
+    return idx;
+}
 
-    char timeBuf[64];
-    getTimestamp(timeBuf, sizeof(timeBuf));
+int findClientByNode(Worker *w, int nodeId) {
+    uint64_t t = monoNs();
+    int idx = registryFindNode(&w->reg, nodeId);
+    if (idx == -1) {
+        mutexLock(&w->cs);
+        idx = registryFindNode(&w->reg, nodeId);
+        mutexUnlock(&w->cs);
+    }
+    histSince(w->m, H_REGISTRY, t);
+    return idx;
+}
 
-    fprintf(fp, "[%s] Node%d %s -> %s\n",
-            timeBuf, nodeId, eventType, data);
+/* ---------- ARM LIVENESS TIMER ----------
+ * Marks the node active and pushes its disconnect deadline
+ * CLIENT_TIMEOUT into the future. O(1); caller holds the shard lock.
+ */
+void armLiveness(Worker *w, int idx) {
+    Client *c = registryAt(&w->reg, idx);
+    uint64_t now = nowMs();
+    atomic_store(&c->lastSeen, now);
+    atomic_store(&c->active, 1);
+    wheelSchedule(&w->wheel, idx, now + CLIENT_TIMEOUT * 1000);
+}
+
+/* ---------- KEEP ALIVE ----------
+ * Every packet from a known node lands here. The common case is one
+ * atomic store: the wheel timer stays where it is and onNodeExpired()
+ * pushes it on if the node has been heard from since. Only a node
+ * that had already timed out takes the lock to be re-armed.
+ */
+void keepAlive(Worker *w, int idx) {
+    Client *c = registryAt(&w->reg, idx);
+    atomic_store(&c->lastSeen, nowMs());
+    if (atomic_load(&c->active)) return;
 
-    fclose(fp);
+    mutexLock(&w->cs);
+    if (!atomic_load(&c->active)) armLiveness(w, idx);
+    mutexUnlock(&w->cs);
 }
 
-/* ---------- FIND CLIENT ---------- */
-int findClientByAddr(struct sockaddr_in *addr) {
-    for (int i = 0; i < clientCount; i++) {
-        if (clients[i].registered &&
-            clients[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
-            clients[i].addr.sin_port == addr->sin_port) {
-            return i;
+/* ---------- RETIRE FROM OTHER SHARDS ----------
+ * A node that comes back from a new source port can hash to another
+ * worker. Drop its old entry there so only one shard tracks it, and
+ * hand its series over in *moved. Returns 1 if the node was known
+ * elsewhere.
+ */
+int retireFromOtherShards(Worker *self, int nodeId, Series **moved, NodePolicy **policy) {
+    int found = 0;
+    for (int k = 0; k < workerCount; k++) {
+        Worker *w = &workers[k];
+        if (w == self) continue;
+
+        mutexLock(&w->cs);
+        int i = registryFindNode(&w->reg, nodeId);
+        if (i != -1 && clientBound(registryAt(&w->reg, i))) {
+            Client *c = registryAt(&w->reg, i);
+            registryUnbind(&w->reg, i);
+            wheelCancel(&w->wheel, i);
+            if (!*moved) {
+                *moved = c->series;
+                c->series = NULL;
+            }
+            if (!*policy) {
+                *policy = c->policy;
+                c->policy = NULL;
+                atomic_store(&c->policyPending, 0);
+            }
+            found = 1;
         }
+        mutexUnlock(&w->cs);
     }
-    return -1;
+    return found;
 }
 
 /* ---------- REGISTER / RECONNECT ---------- */
-void registerClient(struct sockaddr_in *addr, int nodeId) {
-    EnterCriticalSection(&cs);
+void registerClient(Worker *w, struct sockaddr_in *addr, int nodeId) {
+    mutexLock(&w->cs);
+    uint64_t held = monoNs();
+
+    int i = registryFindNode(&w->reg, nodeId);
+    if (i != -1 && clientBound(registryAt(&w->reg, i))) {
+        Client *c = registryAt(&w->reg, i);
+        registrySetAddr(&w->reg, i, addr);
+        armLiveness(w, i);
+        if (c->series)
+            strcpy(c->series->lastEvent, "RECONNECT");
+
+        logToFile(nodeId, "RECONNECT", "Client reconnected");
+        printf("🟡 Node%d reconnected\n", nodeId);
 
-    for (int i = 0; i < clientCount; i++) {
-        if (clients[i].nodeId == nodeId) {
-            clients[i].addr = *addr;
-            clients[i].active = 1;
-            clients[i].registered = 1;
-            clients[i].lastSeen = time(NULL);
+        histSince(w->m, H_REGISTER_LOCK, held);
+        mutexUnlock(&w->cs);
+        return;
+    }
+    int known = i != -1;
+    histSince(w->m, H_REGISTER_LOCK, held);
+    mutexUnlock(&w->cs);
+
+    /* cold path: first sighting in this shard, or back after a move */
+    Series *moved = NULL;
+    NodePolicy *policy = NULL;
+    if (workerCount > 1 && retireFromOtherShards(w, nodeId, &moved, &policy))
+        known = 1;
 
+    mutexLock(&w->cs);
+    held = monoNs();
+    int idx = registryFindNode(&w->reg, nodeId);
+    if (idx != -1) registrySetAddr(&w->reg, idx, addr);
+    else           idx = registryAdd(&w->reg, addr, nodeId);
+
+    if (idx != -1) {
+        Client *c = registryAt(&w->reg, idx);
+        if (!c->series) { c->series = moved; moved = NULL; }
+        if (!c->series) c->series = seriesNew(nodeId);
+        if (!c->policy && policy) {
+            /* resent once from here; the node acks a version it has */
+            c->policy = policy;
+            policy = NULL;
+            c->policy->sentAt = 0;
+            atomic_store(&c->policyPending, 1);
+        }
+        armLiveness(w, idx);
+
+        if (known) {
+            if (c->series) strcpy(c->series->lastEvent, "RECONNECT");
             logToFile(nodeId, "RECONNECT", "Client reconnected");
             printf("🟡 Node%d reconnected\n", nodeId);
+        } else {
+            if (c->series) {
+                c->series->registrations++;
+                strcpy(c->series->lastEvent, "REGISTER");
+            }
+            logToFile(nodeId, "REGISTER", "New client registered");
+            printf("🟢 Node%d registered\n", nodeId);
+        }
+    }
+    histSince(w->m, H_REGISTER_LOCK, held);
+    mutexUnlock(&w->cs);
+    seriesFree(moved);
+    free(policy);
+}
+
+/* ---------- UPDATE LAST SEEN ---------- */
+void updateLastSeen(Worker *w, struct sockaddr_in *addr) {
+    int idx = findClientByAddr(w, addr);
+    if (idx != -1)
+        keepAlive(w, idx);
+}
+
+/* ---------- NODE TIMED OUT ----------
+ * Wheel callback; runs on the owning worker with the shard lock held.
+ * A node heard from since the timer was armed gets a new deadline.
+ * active is cleared before lastSeen is checked a second time, so a
+ * racing keepAlive() either is seen here or sees the node inactive
+ * and re-arms it itself.
+ */
+int rearmIfSeen(Worker *w, int idx, Client *c) {
+    uint64_t now = nowMs();
+    uint64_t due = atomic_load(&c->lastSeen) + CLIENT_TIMEOUT * 1000;
+    if (due <= now) return 0;
+
+    /* never for the tick being fired (timerwheel.h) */
+    if (due < now + w->wheel.tickMs) due = now + w->wheel.tickMs;
+    wheelSchedule(&w->wheel, idx, due);
+    return 1;
+}
+
+void onNodeExpired(void *ctx, int idx) {
+    Worker *w = (Worker*)ctx;
+    Client *c = registryAt(&w->reg, idx);
+    if (!atomic_load(&c->active) || rearmIfSeen(w, idx, c)) return;
+
+    atomic_store(&c->active, 0);
+    if (rearmIfSeen(w, idx, c)) {
+        atomic_store(&c->active, 1);
+        return;
+    }
+    if (c->series) strcpy(c->series->lastEvent, "DISCONNECT");
+
+    logToFile(c->nodeId,
+              "DISCONNECT",
+              "Client inactive timeout");
+
+    printf("🔴 Node%d disconnected\n", c->nodeId);
+}
+
+/* ---------- TOUCH NODE (v2) ----------
+ * v2 frames carry their nodeId, so the node is looked up by id rather
+ * than guessed from the source address. A node we have not seen from
+ * this address goes through the normal register/reconnect path.
+ * Returns the node's index, -1 if it could not be registered.
+ */
+int touchNode(Worker *w, struct sockaddr_in *addr, int nodeId) {
+    int idx = findClientByNode(w, nodeId);
+    if (idx != -1 &&
+        atomic_load(&registryAt(&w->reg, idx)->bound) == (addrKey(addr) | CLIENT_BOUND)) {
+        keepAlive(w, idx);
+        return idx;
+    }
+    registerClient(w, addr, nodeId);
+    return findClientByNode(w, nodeId);
+}
+
+/* ---------- POLICY DOWNLINK ----------
+ * sendPolicy() and queuePolicy() run under the shard lock.
+ */
+void sendPolicy(Worker *w, Client *c, uint64_t now) {
+    unsigned char frame[POLICY_SIZE];
+    int len = encodePolicy(frame, (uint32_t)c->nodeId, c->policy->version, &c->policy->want);
+    sendto(w->sock, (const char*)frame, len, 0,
+           (const struct sockaddr*)&c->addr, sizeof(c->addr));
+    c->policy->sentAt = now;
+}
+
+/* Merges u into what the node should run, as `version`, and sends it
+   straight away. Returns -1 if out of memory. */
+int queuePolicy(Worker *w, Client *c, const PolicyUpdate *u, uint32_t version) {
+    if (!c->policy && !(c->policy = calloc(1, sizeof(NodePolicy))))
+        return -1;
+    policyMerge(&c->policy->want, u);
+    c->policy->version = version;
+    atomic_store(&c->policyPending, 1);
+    if (clientBound(c)) sendPolicy(w, c, nowMs());
+    return 0;
+}
+
+/* Frame path: one relaxed load unless a policy is outstanding. */
+void resendPolicy(Worker *w, int idx) {
+    Client *c = registryAt(&w->reg, idx);
+    if (!atomic_load_explicit(&c->policyPending, memory_order_relaxed)) return;
+
+    uint64_t now = nowMs();
+    mutexLock(&w->cs);
+    if (atomic_load(&c->policyPending) && clientBound(c) &&
+        now - c->policy->sentAt >= POLICY_RESEND_MS)
+        sendPolicy(w, c, now);
+    mutexUnlock(&w->cs);
+}
+
+/* A (re)started node runs its own defaults again: send it what it
+   should run, or what every node was told if nothing is on record. */
+void restorePolicy(Worker *w, int idx) {
+    Client *c = registryAt(&w->reg, idx);
+    mutexLock(&w->cs);
+    if (c->policy) {
+        c->policy->sentAt = 0;
+        atomic_store(&c->policyPending, 1);
+        if (clientBound(c)) sendPolicy(w, c, nowMs());
+    } else {
+        mutexLock(&policyCs);
+        PolicyUpdate all = policyAll;
+        mutexUnlock(&policyCs);
+        if (all.mask) queuePolicy(w, c, &all, atomic_fetch_add(&policyVersion, 1) + 1);
+    }
+    mutexUnlock(&w->cs);
+}
+
+/* The node's answer: seq is the version it now runs. */
+void policyAcked(Worker *w, int idx, uint32_t version) {
+    Client *c = registryAt(&w->reg, idx);
+    char text[256] = "";
+
+    mutexLock(&w->cs);
+    int done = atomic_load(&c->policyPending) && c->policy->version == version;
+    if (done) {
+        atomic_store(&c->policyPending, 0);
+        policyDescribe(&c->policy->want, text, sizeof(text));
+    }
+    mutexUnlock(&w->cs);
+
+    if (done) {
+        logToFile(c->nodeId, "POLICY", text);
+        if (debugPacket(w)) printf("🛠️ Node%d runs policy v%u: %s\n", c->nodeId, version, text);
+    }
+}
+
+/* ---------- LOG READING ----------
+ * r->timeMs is the (trusted) reading time in unix ms. extra holds
+ * " KEY=value" fields the server has no column for (may be NULL).
+ */
+void logReading(Worker *w, int nodeId, const Reading *r, const char *extra) {
+    char logBuf[LOG_DATA_MAX];
+    snprintf(logBuf, sizeof(logBuf),
+             "TEMP=%.2f HUM=%.2f SOIL=%d WATER=%d%s",
+             r->temp, r->hum, r->soil, r->water, extra ? extra : "");
+
+    if (debugPacket(w)) printf("📡 Node%d -> %s\n", nodeId, logBuf);
+    logReadingEntry(nodeId, logBuf, r);
+    counterAdd(w->m, C_READINGS, 1);
+}
+
+/* ---------- READING TIME ----------
+ * Node clock for v2 readings, unless it is unset or implausibly far
+ * in the future, in which case the arrival time is used.
+ */
+time_t readingTime(const Reading *r) {
+    time_t now = time(NULL);
+    time_t when = (time_t)(r->timeMs / 1000);
+    return (when == 0 || when > now + 60) ? now : when;
+}
+
+/* ---------- FLOOD ALERT ----------
+ * A level or flash flood change from flood.h: one ALERT log line and
+ * one JSON line to the alert subscribers, straight from the ingest
+ * path. Called without the shard lock.
+ */
+void raiseAlert(Worker *w, const FloodEvent *ev) {
+    char text[LOG_DATA_MAX];
+    char json[LOG_DATA_MAX];
+    uint64_t t = monoNs();
+
+    floodEventText(ev, text, sizeof(text));
+    logToFile(ev->nodeId, "ALERT", text);
+    int len = floodEventJson(ev, json, sizeof(json));
+    if (len > 0 && len < (int)sizeof(json))
+        alertPublish(json, (size_t)len);
+
+    counterAdd(w->m, C_ALERTS, 1);
+    histSince(w->m, H_ALERT, t);
+    const char *icon = ev->level == FLOOD_CRIT || ev->flash ? "🚨" :
+                       ev->level == FLOOD_WARN ? "⚠️" : "✅";
+    if (ev->level != ev->prevLevel)
+        printf("%s Node%d flood level %s -> %s (water %d, %+.1f/min)\n", icon, ev->nodeId,
+               floodLevelNames[ev->prevLevel], floodLevelNames[ev->level], ev->water, ev->rate);
+    else
+        printf("%s Node%d flash flood %s (water %d, %+.1f/min)\n", icon, ev->nodeId,
+               ev->flash ? "risk" : "over", ev->water, ev->rate);
+}
+
+/* ---------- STORE READINGS ----------
+ * Appends to the node's in-memory series under one lock per packet,
+ * running each reading through the flood rules on the way.
+ * r[i].timeMs must already be a trusted unix-ms time.
+ */
+void storeReadings(Worker *w, int nodeId, const Reading *r, int n) {
+    FloodEvent ev[BATCH_MAX_READINGS];
+    int alerts = 0;
+
+    mutexLock(&w->cs);
+    int idx = registryFindNode(&w->reg, nodeId);
+    if (idx != -1) {
+        Client *c = registryAt(&w->reg, idx);
+        if (!c->series) c->series = seriesNew(nodeId);
+        if (c->series) {
+            for (int i = 0; i < n; i++) {
+                seriesAppend(c->series, (int64_t)r[i].timeMs, r[i].temp,
+                             r[i].hum, r[i].soil, r[i].water);
+                if (alerts < BATCH_MAX_READINGS &&
+                    floodUpdate(&c->series->flood, nodeId, (int64_t)r[i].timeMs, r[i].temp,
+                                r[i].hum, r[i].soil, r[i].water, &ev[alerts]))
+                    alerts++;
+            }
+        }
+    }
+    mutexUnlock(&w->cs);
+
+    for (int i = 0; i < alerts; i++)
+        raiseAlert(w, &ev[i]);
+}
+
+/* ---------- SEQUENCE CHECK ----------
+ * Drops duplicates from r[0..n), where reading i carries sequence
+ * seq + i, compacting in place. Returns how many readings are left.
+ */
+int acceptSeq(Worker *w, int nodeId, uint32_t seq, Reading *r, int n) {
+    int kept = n;
+    mutexLock(&w->cs);
+    int idx = registryFindNode(&w->reg, nodeId);
+    Series *s = idx != -1 ? registryAt(&w->reg, idx)->series : NULL;
+    if (s) {
+        kept = 0;
+        for (int i = 0; i < n; i++)
+            if (seqCheck(&s->seq, seq + (uint32_t)i)) r[kept++] = r[i];
+    }
+    mutexUnlock(&w->cs);
+    counterAdd(w->m, C_DUPLICATES, (uint64_t)(n - kept));
+    return kept;
+}
 
-            LeaveCriticalSection(&cs);
+/* A REGISTER comes from a (re)started node: its numbering starts over. */
+void resetSeq(Worker *w, int nodeId) {
+    mutexLock(&w->cs);
+    int idx = registryFindNode(&w->reg, nodeId);
+    if (idx != -1 && registryAt(&w->reg, idx)->series)
+        seqReset(&registryAt(&w->reg, idx)->series->seq);
+    mutexUnlock(&w->cs);
+}
+
+/* ---------- SELECTIVE ACK ----------
+ * Frames flagged FRAME_ACK_REQ (duplicates included: the first ACK
+ * may have been lost) queue their node here. After each receive
+ * batch flushAcks() answers every queued node once with its current
+ * SeqTrack state, all in one sendmmsg, so a node streaming readings
+ * costs at most one small datagram per batch.
+ */
+void flushAcks(Worker *w);
+
+void queueAck(Worker *w, int nodeId, struct sockaddr_in *addr) {
+    PacketBatch *b = &w->acks;
+    for (int i = 0; i < b->count; i++) {
+        if (w->ackNode[i] == nodeId) {
+            b->addr[i] = *addr;
             return;
         }
     }
+    if (b->count == RECV_BATCH) flushAcks(w);
+    w->ackNode[b->count] = nodeId;
+    b->addr[b->count] = *addr;
+    b->count++;
+}
 
-    if (clientCount < MAX_CLIENTS) {
-        clients[clientCount].addr = *addr;
-        clients[clientCount].nodeId = nodeId;
-        clients[clientCount].registered = 1;
-        clients[clientCount].active = 1;
-        clients[clientCount].lastSeen = time(NULL);
+void flushAcks(Worker *w) {
+    PacketBatch *b = &w->acks;
+    if (!b->count) return;
 
-        logToFile(nodeId, "REGISTER", "New client registered");
-        printf("🟢 Node%d registered\n", nodeId);
+    mutexLock(&w->cs);
+    for (int i = 0; i < b->count; i++) {
+        uint32_t cum = 0;
+        uint64_t sack = 0;
+        int idx = registryFindNode(&w->reg, w->ackNode[i]);
+        if (idx != -1 && registryAt(&w->reg, idx)->series)
+            seqAck(&registryAt(&w->reg, idx)->series->seq, &cum, &sack);
+        b->len[i] = encodeAck((unsigned char*)b->buf[i], (uint32_t)w->ackNode[i], cum, sack);
+    }
+    mutexUnlock(&w->cs);
+
+    counterAdd(w->m, C_ACKS, (uint64_t)udpSendBatch(w->sock, b, b->count));
+    b->count = 0;
+}
 
-        clientCount++;
+/* ---------- HANDLE v2 FRAME ---------- */
+void handleFrame(Worker *w, const unsigned char *buf, int len,
+                 struct sockaddr_in *clientAddr) {
+    FrameHeader h;
+    Reading r[BATCH_MAX_READINGS];
+
+    uint64_t t = monoNs();
+    int n = decodeFrame(buf, len, &h, r, BATCH_MAX_READINGS);
+    histSince(w->m, H_PARSE, t);
+    counterAdd(w->m, C_FRAMES_V2, 1);
+    if (n < 0) {
+        counterAdd(w->m, C_PARSE_ERRORS, 1);
+        atomic_fetch_add(&malformedFrames, 1);
+        logToFile(0, "UNKNOWN", "Malformed v2 frame");
+        return;
     }
 
-    LeaveCriticalSection(&cs);
+    int nodeId = (int)h.nodeId;
+    int idx;
+
+    switch (h.type) {
+    case FRAME_REGISTER:
+        registerClient(w, clientAddr, nodeId);
+        resetSeq(w, nodeId);
+        idx = findClientByNode(w, nodeId);
+        if (idx != -1) restorePolicy(w, idx);
+        break;
+    case FRAME_HEARTBEAT:
+        idx = touchNode(w, clientAddr, nodeId);
+        if (idx != -1) resendPolicy(w, idx);
+        break;
+    case FRAME_POLICY:
+        idx = touchNode(w, clientAddr, nodeId);
+        if (idx != -1) policyAcked(w, idx, h.seq);
+        break;
+    case FRAME_DATA:
+    case FRAME_BATCH:
+        idx = touchNode(w, clientAddr, nodeId);
+        if (idx != -1) resendPolicy(w, idx);
+        n = acceptSeq(w, nodeId, h.seq, r, n);
+        if (h.ackReq) queueAck(w, nodeId, clientAddr);
+        for (int i = 0; i < n; i++) {
+            time_t when = readingTime(&r[i]);
+            if (when != (time_t)(r[i].timeMs / 1000))
+                r[i].timeMs = (uint64_t)when * 1000;
+            logReading(w, nodeId, &r[i], NULL);
+        }
+        storeReadings(w, nodeId, r, n);
+        break;
+    }
 }
 
-/* ---------- UPDATE LAST SEEN ---------- */
-void updateLastSeen(struct sockaddr_in *addr) {
-    EnterCriticalSection(&cs);
-    int idx = findClientByAddr(addr);
-    if (idx != -1) {
-        clients[idx].lastSeen = time(NULL);
-        clients[idx].active = 1;
+/* ---------- HANDLE ONE DATAGRAM ---------- */
+void handlePacket(Worker *w, char *buffer, int len, struct sockaddr_in *clientAddr) {
+    /* ---------- BINARY v2 ---------- */
+    if (isFrameV2((const unsigned char*)buffer, len)) {
+        handleFrame(w, (const unsigned char*)buffer, len, clientAddr);
+        return;
     }
-    LeaveCriticalSection(&cs);
+
+    const char *rest;
+    KvField f[KV_MAX_FIELDS];
+    const KvField *id;
+    int n, nodeId;
+    uint64_t t = monoNs();
+
+    counterAdd(w->m, C_MESSAGES_V1, 1);
+    switch (kvVerb(buffer, (size_t)len, &rest)) {
+    /* ---------- END OF READING (no-op) ---------- */
+    case MSG_EOF:
+        return;
+
+    /* ---------- HEARTBEAT ---------- */
+    case MSG_HEARTBEAT:
+        updateLastSeen(w, clientAddr);
+        return;
+
+    /* ---------- REGISTER ---------- */
+    case MSG_REGISTER:
+        n = kvParse(rest, (size_t)(buffer + len - rest), f, KV_MAX_FIELDS);
+        id = kvFind(f, n, "NODE");
+        if (id && id->isNum && kvNodeId(id->num, &nodeId)) {
+            registerClient(w, clientAddr, nodeId);
+            resetSeq(w, nodeId);
+        }
+        else counterAdd(w->m, C_PARSE_ERRORS, 1);
+        return;
+
+    /* ---------- NODE ---------- */
+    case MSG_NODE: {
+        double v;
+        int used = kvNumber(rest, buffer + len, &v);
+        if (used > 0 && kvNodeId(v, &nodeId))
+            registerClient(w, clientAddr, nodeId);
+        else counterAdd(w->m, C_PARSE_ERRORS, 1);
+        return;
+    }
+
+    /* ---------- DATA ---------- */
+    case MSG_DATA: {
+        Reading r;
+        n = kvParse(rest, (size_t)(buffer + len - rest), f, KV_MAX_FIELDS);
+        histSince(w->m, H_PARSE, t);
+
+        int idx = findClientByAddr(w, clientAddr);
+
+        /* NODE= keeps DATA self-describing when it overtakes NODE: */
+        id = kvFind(f, n, "NODE");
+        if (idx == -1 && id) {
+            if (id->isNum && kvNodeId(id->num, &nodeId)) {
+                registerClient(w, clientAddr, nodeId);
+                idx = findClientByAddr(w, clientAddr);
+            }
+            else counterAdd(w->m, C_PARSE_ERRORS, 1);
+        }
+
+        /* nodeId never changes once a record is published */
+        nodeId = (idx != -1) ? registryAt(&w->reg, idx)->nodeId : 0;
+        if (idx != -1) keepAlive(w, idx);
+
+        int complete = kvReading(f, n, &r) == SENSOR_ALL;
+        /* a SEQ that is not a valid uint32 is ignored: wrapped, it
+           would move the node's window and drop real readings */
+        const KvField *seq = kvFind(f, n, "SEQ");
+        uint32_t seqNo;
+        if (seq && !(seq->isNum && kvSeq(seq->num, &seqNo))) {
+            counterAdd(w->m, C_PARSE_ERRORS, 1);
+            seq = NULL;
+        }
+        if (complete && seq && idx != -1 &&
+            acceptSeq(w, nodeId, seqNo, &r, 1) == 0)
+            return;                 // duplicate
+
+        if (complete) {
+            char extra[LOG_DATA_MAX / 2];
+            kvExtras(f, n, extra, sizeof(extra));
+
+            r.timeMs = wallMs();
+            logReading(w, nodeId, &r, extra);
+            if (idx != -1)
+                storeReadings(w, nodeId, &r, 1);
+        }
+        else {
+            /* fallback */
+            counterAdd(w->m, C_PARSE_ERRORS, 1);
+            if (debugPacket(w)) printf("📡 Node%d -> %s\n", nodeId, buffer);
+            logToFile(nodeId, "DATA", buffer);
+        }
+        return;
+    }
+    }
+    counterAdd(w->m, C_PARSE_ERRORS, 1);     // unknown verb
 }
 
-/* ---------- MONITOR DISCONNECT ---------- */
-DWORD WINAPI monitorClients(LPVOID lpParam) {
-    while (1) {
-        Sleep(2000);
-        time_t now = time(NULL);
+/* ---------- INGEST WORKER LOOP ---------- */
+THREAD_FUNC(workerLoop) {
+    Worker *w = (Worker*)arg;
+    Poller poller;
 
-        EnterCriticalSection(&cs);
-        for (int i = 0; i < clientCount; i++) {
-            if (clients[i].active &&
-                difftime(now, clients[i].lastSeen) > CLIENT_TIMEOUT) {
+    /* Non-blocking socket: we sleep in the poller, then drain the
+       receive queue a whole batch per syscall (recvmmsg on Linux). */
+    pollerInit(&poller);
+    pollerAdd(&poller, w->sock, 0);
+    batchInit(&w->batch);
+    batchInit(&w->acks);
 
-                clients[i].active = 0;
+    while (1) {
+        int ready;
+        mutexLock(&w->cs);
+        int timeout = wheelNextTimeout(&w->wheel, nowMs());
+        mutexUnlock(&w->cs);
 
-                logToFile(clients[i].nodeId,
-                          "DISCONNECT",
-                          "Client inactive timeout");
+        if (pollerWait(&poller, &ready, 1, timeout) > 0) {
+            while (1) {
+                uint64_t t = monoNs();
+                if (udpRecvBatch(w->sock, &w->batch) <= 0) break;
+                histSince(w->m, H_RECV, t);
+                counterAdd(w->m, C_RECV_CALLS, 1);
+                counterAdd(w->m, C_PACKETS, (uint64_t)w->batch.count);
 
-                printf("🔴 Node%d disconnected\n", clients[i].nodeId);
+                for (int i = 0; i < w->batch.count; i++) {
+                    if (w->batch.len[i] <= 0) continue;
+                    counterAdd(w->m, C_BYTES, (uint64_t)w->batch.len[i]);
+                    handlePacket(w, w->batch.buf[i], w->batch.len[i], &w->batch.addr[i]);
+                }
+                flushAcks(w);
             }
         }
-        LeaveCriticalSection(&cs);
+
+        /* ---------- LIVENESS ---------- */
+        mutexLock(&w->cs);
+        wheelAdvance(&w->wheel, nowMs(), onNodeExpired, w);
+        mutexUnlock(&w->cs);
+        epochReclaim();             // index tables retired by a grow
     }
-    return 0;
+
+    pollerClose(&poller);
+    THREAD_RETURN;
 }
 
-/* ================= MAIN ================= */
-int main() {
-    WSADATA wsa;
-    SOCKET serverSocket;
-    struct sockaddr_in serverAddr, clientAddr;
-    char buffer[BUFFER_SIZE];
-    int addrLen = sizeof(clientAddr);
+/* ================= QUERY COMMANDS =================
+ * Served on the loopback query socket (query.h), one line each:
+ *   LATEST n [node]              newest n readings, oldest first
+ *   RANGE node from to [limit]   readings between unix seconds
+ *   NODES                        per-node aggregates
+ *   NODE id                      one node's aggregates
+ *   OVERVIEW                     system totals
+ *   ROLLUP node from to [points] downsampled buckets, tier picked
+ *                                so the range fits in `points`
+ *   LOSS                         per-node sequence accounting
+ *   FLOOD                        per-node flood level, risk and
+ *                                water rate (flood.h)
+ *   POLICY node|* key=value ...  change nodes' send policy
+ *                                (sendpolicy.h keys, e.g.
+ *                                water-rate=4 max-silence-ms=60000)
+ * Replies use the same JSON shapes as the dashboard API.
+ */
+#define QUERY_ROWS_MAX 10000
+
+typedef struct {
+    int nodeId;
+    int order;          // position in the node's ring, breaks time ties
+    SeriesRow row;
+} NodeRow;
+
+typedef struct {
+    Series s;           // shallow copy: totals only, ring not valid
+    int active;
+} NodeSnap;
+
+typedef void (*SeriesVisit)(void *ctx, const Client *c);
+
+/* Calls fn for every node that has a series, under its shard lock. */
+void forEachSeries(SeriesVisit fn, void *ctx) {
+    for (int k = 0; k < workerCount; k++) {
+        Worker *w = &workers[k];
+        mutexLock(&w->cs);
+        for (int i = 0; i < registryCount(&w->reg); i++)
+            if (registryAt(&w->reg, i)->series)
+                fn(ctx, registryAt(&w->reg, i));
+        mutexUnlock(&w->cs);
+    }
+}
+
+void jsonTime(StrBuf *out, const char *key, int64_t ms) {
+    char timeBuf[64];
+    getTimestamp((time_t)(ms / 1000), timeBuf, sizeof(timeBuf));
+    sbPrintf(out, "\"%s\":\"%s\"", key, timeBuf);
+}
 
-    InitializeCriticalSection(&cs);
-    WSAStartup(MAKEWORD(2,2), &wsa);
+void jsonRows(StrBuf *out, const NodeRow *rows, int n) {
+    sbPrintf(out, "[");
+    for (int i = 0; i < n; i++) {
+        const SeriesRow *r = &rows[i].row;
+        sbPrintf(out, "%s{", i ? "," : "");
+        jsonTime(out, "time", r->timeMs);
+        sbPrintf(out, ",\"node\":%d,\"temperature\":%.2f,\"humidity\":%.2f,"
+                      "\"soil\":%d,\"water\":%d}",
+                 rows[i].nodeId, r->temp, r->hum, (int)r->soil, (int)r->water);
+    }
+    sbPrintf(out, "]");
+}
 
-    serverSocket = socket(AF_INET, SOCK_DGRAM, 0);
+void jsonNode(StrBuf *out, const NodeSnap *n) {
+    const Series *s = &n->s;
+    const MetricAgg *a = s->agg;
+    double cnt = s->total ? (double)s->total : 1;
 
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(SERVER_PORT);
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    sbPrintf(out, "{\"id\":%d,\"totalReadings\":%llu,",
+             s->nodeId, (unsigned long long)s->total);
+    jsonTime(out, "lastSeen", s->lastMs);
+    sbPrintf(out, ",");
+    jsonTime(out, "firstSeen", s->firstMs);
+    sbPrintf(out, ",\"avgTemp\":%.2f,\"avgHum\":%.2f,\"avgSoil\":%.2f,\"avgWater\":%.2f",
+             a[METRIC_TEMP].sum / cnt, a[METRIC_HUM].sum / cnt,
+             a[METRIC_SOIL].sum / cnt, a[METRIC_WATER].sum / cnt);
+    sbPrintf(out, ",\"minTemp\":%.2f,\"maxTemp\":%.2f,\"minHum\":%.2f,\"maxHum\":%.2f",
+             a[METRIC_TEMP].min, a[METRIC_TEMP].max,
+             a[METRIC_HUM].min, a[METRIC_HUM].max);
+    sbPrintf(out, ",\"minSoil\":%g,\"maxSoil\":%g,\"minWater\":%g,\"maxWater\":%g",
+             a[METRIC_SOIL].min, a[METRIC_SOIL].max,
+             a[METRIC_WATER].min, a[METRIC_WATER].max);
+    sbPrintf(out, ",\"registrations\":%d,\"status\":\"%s\",\"lastEvent\":\"%s\"}",
+             s->registrations, n->active ? "online" : "offline", s->lastEvent);
+}
 
-    bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
+int cmpNodeRow(const void *a, const void *b) {
+    const NodeRow *x = a, *y = b;
+    if (x->row.timeMs != y->row.timeMs)
+        return x->row.timeMs < y->row.timeMs ? -1 : 1;
+    if (x->nodeId != y->nodeId)
+        return x->nodeId < y->nodeId ? -1 : 1;
+    return (x->order > y->order) - (x->order < y->order);
+}
 
-    CreateThread(NULL, 0, monitorClients, NULL, 0, NULL);
+int cmpNodeSnap(const void *a, const void *b) {
+    const NodeSnap *x = a, *y = b;
+    return (x->s.nodeId > y->s.nodeId) - (x->s.nodeId < y->s.nodeId);
+}
 
-    printf("✅ Server running on port %d\n", SERVER_PORT);
+/* ---------- LATEST (all nodes) ----------
+ * Keeps the newest `max` rows in a min-heap on time, so memory stays
+ * O(limit) however many nodes there are. Each series is walked from
+ * its newest reading and stops once it is older than the heap top.
+ */
+typedef struct {
+    NodeRow *heap;
+    int count;
+    int max;
+} LatestCtx;
 
+void heapSift(NodeRow *h, int n, int i) {
     while (1) {
-        int bytes = recvfrom(serverSocket, buffer, BUFFER_SIZE - 1, 0,
-                             (struct sockaddr*)&clientAddr, &addrLen);
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && cmpNodeRow(&h[l], &h[m]) < 0) m = l;
+        if (r < n && cmpNodeRow(&h[r], &h[m]) < 0) m = r;
+        if (m == i) return;
+        NodeRow t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
 
-        if (bytes <= 0) continue;
-        buffer[bytes] = '\0';
+void visitLatest(void *ctx, const Client *c) {
+    LatestCtx *q = ctx;
+    const Series *s = c->series;
 
-        /* ---------- HEARTBEAT ---------- */
-        if (strncmp(buffer, "HEARTBEAT:", 10) == 0) {
-            updateLastSeen(&clientAddr);
-            continue;
+    for (int k = s->count - 1; k >= 0; k--) {
+        NodeRow nr;
+        nr.nodeId = s->nodeId;
+        nr.order = k;
+        seriesRow(s, k, &nr.row);
+
+        if (q->count < q->max) {
+            int i = q->count++;
+            q->heap[i] = nr;
+            while (i > 0 && cmpNodeRow(&q->heap[i], &q->heap[(i - 1) / 2]) < 0) {
+                NodeRow t = q->heap[i];
+                q->heap[i] = q->heap[(i - 1) / 2];
+                q->heap[(i - 1) / 2] = t;
+                i = (i - 1) / 2;
+            }
+        } else if (cmpNodeRow(&nr, &q->heap[0]) > 0) {
+            q->heap[0] = nr;
+            heapSift(q->heap, q->count, 0);
+        } else {
+            break;
         }
+    }
+}
+
+/* ---------- ONE NODE ---------- */
+typedef struct {
+    int nodeId;
+    int limit;
+    int64_t fromMs, toMs;   // RANGE only
+    int range;
+    NodeRow *rows;
+    int count;
+} NodeQueryCtx;
+
+void visitNodeRows(void *ctx, const Client *c) {
+    NodeQueryCtx *q = ctx;
+    if (c->nodeId != q->nodeId) return;
+
+    SeriesRow *tmp = malloc(q->limit * sizeof(SeriesRow));
+    if (!tmp) return;
+    int n = q->range
+          ? seriesRange(c->series, q->fromMs, q->toMs, tmp, q->limit)
+          : seriesLatest(c->series, q->limit, tmp);
+    for (int i = 0; i < n; i++) {
+        q->rows[i].nodeId = c->nodeId;
+        q->rows[i].order = i;
+        q->rows[i].row = tmp[i];
+    }
+    q->count = n;
+    free(tmp);
+}
+
+/* ---------- ROLLUP ---------- */
+#define ROLLUP_POINTS 500
+
+typedef struct {
+    int nodeId;
+    int tier;
+    int64_t fromMs, toMs;
+    RollupBucket *out;
+    int max;
+    int count;
+} RollupCtx;
+
+void visitRollup(void *ctx, const Client *c) {
+    RollupCtx *q = ctx;
+    if (c->nodeId != q->nodeId) return;
+    q->count = seriesRollup(c->series, q->tier, q->fromMs, q->toMs, q->out, q->max);
+}
+
+void jsonRollup(StrBuf *out, const RollupCtx *q) {
+    static const char *names[METRIC_COUNT] = {
+        "temperature", "humidity", "soil", "water"
+    };
+
+    sbPrintf(out, "{\"node\":%d,\"tier\":\"%s\",\"spanMs\":%lld,\"points\":[",
+             q->nodeId, rollupTiers[q->tier].name,
+             (long long)rollupTiers[q->tier].spanMs);
+    for (int i = 0; i < q->count; i++) {
+        const RollupBucket *b = &q->out[i];
+        sbPrintf(out, "%s{\"time\":%lld,\"count\":%u,\"firstMs\":%lld,\"lastMs\":%lld",
+                 i ? "," : "", (long long)b->startMs, b->count,
+                 (long long)b->firstMs, (long long)b->lastMs);
+        for (int m = 0; m < METRIC_COUNT; m++)
+            sbPrintf(out, ",\"%s\":{\"sum\":%.2f,\"min\":%.2f,\"max\":%.2f,\"last\":%.2f}",
+                     names[m], b->sum[m], b->min[m], b->max[m], b->last[m]);
+        sbPrintf(out, "}");
+    }
+    sbPrintf(out, "]}");
+}
+
+/* ---------- NODE SNAPSHOTS ---------- */
+typedef struct {
+    NodeSnap *snaps;
+    int count;
+    int cap;
+    int onlyNode;           // -1 = all
+} SnapCtx;
+
+void visitSnap(void *ctx, const Client *c) {
+    SnapCtx *q = ctx;
+    if (c->series->total == 0) return;
+    if (q->onlyNode != -1 && c->nodeId != q->onlyNode) return;
+
+    if (q->count == q->cap) {
+        int cap = q->cap ? q->cap * 2 : 64;
+        NodeSnap *p = realloc(q->snaps, cap * sizeof(NodeSnap));
+        if (!p) return;
+        q->snaps = p;
+        q->cap = cap;
+    }
+    q->snaps[q->count].s = *c->series;
+    q->snaps[q->count].active = atomic_load(&c->active);
+    q->count++;
+}
+
+/* ---------- SEQUENCE ACCOUNTING ---------- */
+void jsonSeq(StrBuf *out, const SeqTrack *t) {
+    sbPrintf(out, "\"received\":%llu,\"lost\":%llu,\"reordered\":%llu,"
+                  "\"duplicates\":%llu,\"late\":%llu,\"restarts\":%llu",
+             (unsigned long long)t->received, (unsigned long long)t->lost,
+             (unsigned long long)t->reordered, (unsigned long long)t->duplicates,
+             (unsigned long long)t->late, (unsigned long long)t->restarts);
+}
+
+void jsonLoss(StrBuf *out, const NodeSnap *snaps, int count) {
+    SeqTrack sum;
+    memset(&sum, 0, sizeof(sum));
+
+    sbPrintf(out, "{\"nodes\":[");
+    for (int i = 0; i < count; i++) {
+        const SeqTrack *t = &snaps[i].s.seq;
+        sbPrintf(out, "%s{\"node\":%d,", i ? "," : "", snaps[i].s.nodeId);
+        jsonSeq(out, t);
+        sbPrintf(out, "}");
+
+        sum.received += t->received;
+        sum.lost += t->lost;
+        sum.reordered += t->reordered;
+        sum.duplicates += t->duplicates;
+        sum.late += t->late;
+        sum.restarts += t->restarts;
+    }
+    sbPrintf(out, "],\"totals\":{");
+    jsonSeq(out, &sum);
+    sbPrintf(out, ",\"lossRate\":%.6f,\"acksSent\":%lu}}",
+             sum.received + sum.lost ? (double)sum.lost / (double)(sum.received + sum.lost) : 0.0,
+             (unsigned long)metricsTotal(C_ACKS));
+}
 
-        /* ---------- REGISTER ---------- */
-        if (strncmp(buffer, "REGISTER:", 9) == 0) {
-            int nodeId;
-            sscanf(buffer, "REGISTER:NODE:%d", &nodeId);
-            registerClient(&clientAddr, nodeId);
-            continue;
+/* ---------- FLOOD ---------- */
+typedef struct {
+    StrBuf *out;
+    int count;
+} FloodCtx;
+
+void visitFlood(void *ctx, const Client *c) {
+    FloodCtx *q = (FloodCtx*)ctx;
+    const FloodState *f = &c->series->flood;
+    if (!f->primed) return;
+
+    sbPrintf(q->out, "%s{\"node\":%d,\"level\":\"%s\",\"isFlashFlood\":%s,"
+                     "\"water\":%.0f,\"riskIndex\":%.1f,\"riskAvg\":%.1f,"
+                     "\"changeRate\":%.2f,\"timeMs\":%lld}",
+             q->count++ ? "," : "", c->nodeId, floodLevelNames[f->level],
+             f->flash ? "true" : "false",
+             f->water[(f->head - 1 + FLOOD_WINDOW) % FLOOD_WINDOW],
+             f->risk, f->riskAvg, f->rate, (long long)f->lastMs);
+}
+
+/* ---------- POLICY ----------
+ * Queues the change on every bound record it targets (a node that
+ * moved shards leaves an unbound one behind) and sends it at once.
+ * A `*` change is also kept for nodes that register later.
+ */
+void queryPolicy(const char *line, StrBuf *out) {
+    char target[16] = "";
+    int used = 0;
+    PolicyUpdate u;
+
+    sscanf(line, "%*s %15s %n", target, &used);
+    int all = strcmp(target, "*") == 0;
+    int nodeId = atoi(target);
+    if (!used || (!all && nodeId <= 0) ||
+        policyParse(line + used, strlen(line + used), &u) <= 0) {
+        sbPrintf(out, "{\"error\":\"usage: POLICY node|* key=value ...\"}");
+        return;
+    }
+
+    uint32_t version = atomic_fetch_add(&policyVersion, 1) + 1;
+    if (all) {
+        mutexLock(&policyCs);
+        policyMerge(&policyAll, &u);
+        mutexUnlock(&policyCs);
+    }
+
+    int nodes = 0;
+    for (int k = 0; k < workerCount; k++) {
+        Worker *w = &workers[k];
+        mutexLock(&w->cs);
+        for (int i = 0; i < registryCount(&w->reg); i++) {
+            Client *c = registryAt(&w->reg, i);
+            if (clientBound(c) && (all || c->nodeId == nodeId) &&
+                queuePolicy(w, c, &u, version) == 0)
+                nodes++;
         }
+        mutexUnlock(&w->cs);
+    }
+    if (!all && !nodes) {
+        sbPrintf(out, "{\"error\":\"Node not found\"}");
+        return;
+    }
+
+    char text[256];
+    policyDescribe(&u, text, sizeof(text));
+    sbPrintf(out, "{\"version\":%u,\"nodes\":%d,\"policy\":\"%s\"}", version, nodes, text);
+}
+
+/* ---------- DISPATCH ---------- */
+void handleQuery(const char *line, StrBuf *out) {
+    char cmd[16] = "";
+    long a1 = 0, a2 = 0, a3 = 0, a4 = 0;
+    int argc = sscanf(line, "%15s %ld %ld %ld %ld", cmd, &a1, &a2, &a3, &a4) - 1;
 
-        /* ---------- NODE ---------- */
-        if (strncmp(buffer, "NODE:", 5) == 0) {
-            int nodeId;
-            sscanf(buffer, "NODE:%d", &nodeId);
-            registerClient(&clientAddr, nodeId);
-            continue;
+    if (strcmp(cmd, "LATEST") == 0 && argc >= 1) {
+        int limit = a1 < 1 ? 1 : a1 > QUERY_ROWS_MAX ? QUERY_ROWS_MAX : (int)a1;
+        NodeRow *rows = malloc(limit * sizeof(NodeRow));
+        if (!rows) { sbPrintf(out, "{\"error\":\"out of memory\"}"); return; }
+
+        int n;
+        if (argc >= 2) {
+            NodeQueryCtx q = { (int)a2, limit, 0, 0, 0, rows, 0 };
+            forEachSeries(visitNodeRows, &q);
+            n = q.count;
+        } else {
+            LatestCtx q = { rows, 0, limit };
+            forEachSeries(visitLatest, &q);
+            n = q.count;
+            qsort(rows, n, sizeof(NodeRow), cmpNodeRow);
         }
+        jsonRows(out, rows, n);
+        free(rows);
+        return;
+    }
+
+    if (strcmp(cmd, "RANGE") == 0 && argc >= 3) {
+        int limit = argc >= 4 ? (int)a4 : QUERY_ROWS_MAX;
+        if (limit < 1) limit = 1;
+        if (limit > QUERY_ROWS_MAX) limit = QUERY_ROWS_MAX;
+        NodeRow *rows = malloc(limit * sizeof(NodeRow));
+        if (!rows) { sbPrintf(out, "{\"error\":\"out of memory\"}"); return; }
+
+        NodeQueryCtx q = { (int)a1, limit, (int64_t)a2 * 1000,
+                           (int64_t)a3 * 1000 + 999, 1, rows, 0 };
+        forEachSeries(visitNodeRows, &q);
+        jsonRows(out, rows, q.count);
+        free(rows);
+        return;
+    }
+
+    if (strcmp(cmd, "ROLLUP") == 0 && argc >= 3) {
+        int points = argc >= 4 ? (int)a4 : ROLLUP_POINTS;
+        if (points < 1) points = 1;
+        if (points > QUERY_ROWS_MAX) points = QUERY_ROWS_MAX;
+
+        RollupCtx q;
+        q.nodeId = (int)a1;
+        q.fromMs = (int64_t)a2 * 1000;
+        q.toMs = (int64_t)a3 * 1000 + 999;
+        q.tier = seriesPickTier(q.fromMs, q.toMs, (int64_t)wallMs(), points);
+        q.max = rollupTiers[q.tier].keep;
+        q.count = 0;
+        q.out = malloc(q.max * sizeof(RollupBucket));
+        if (!q.out) { sbPrintf(out, "{\"error\":\"out of memory\"}"); return; }
 
-        /* ---------- DATA ---------- */
-        if (strncmp(buffer, "DATA:", 5) == 0) {
-            updateLastSeen(&clientAddr);
+        forEachSeries(visitRollup, &q);
+        jsonRollup(out, &q);
+        free(q.out);
+        return;
+    }
 
-            int idx = findClientByAddr(&clientAddr);
-            int nodeId = (idx != -1) ? clients[idx].nodeId : 0;
+    if (strcmp(cmd, "FLOOD") == 0) {
+        FloodCtx q = { out, 0 };
+        sbPrintf(out, "[");
+        forEachSeries(visitFlood, &q);
+        sbPrintf(out, "]");
+        return;
+    }
 
-            float temp, hum;
-            int soil, water;
+    if (strcmp(cmd, "POLICY") == 0) {
+        queryPolicy(line, out);
+        return;
+    }
 
-            if (sscanf(buffer,
-                "DATA:TEMP=%f HUM=%f SOIL=%d WATER=%d",
-                &temp, &hum, &soil, &water) == 4) {
+    if (strcmp(cmd, "LOSS") == 0) {
+        SnapCtx q = { NULL, 0, 0, -1 };
+        forEachSeries(visitSnap, &q);
+        qsort(q.snaps, q.count, sizeof(NodeSnap), cmpNodeSnap);
+        jsonLoss(out, q.snaps, q.count);
+        free(q.snaps);
+        return;
+    }
 
-                char logBuf[128];
-                sprintf(logBuf,
-                        "TEMP=%.2f HUM=%.2f SOIL=%d WATER=%d",
-                        temp, hum, soil, water);
+    if (strcmp(cmd, "NODES") == 0 || (strcmp(cmd, "NODE") == 0 && argc >= 1) ||
+        strcmp(cmd, "OVERVIEW") == 0) {
+        SnapCtx q = { NULL, 0, 0, strcmp(cmd, "NODE") == 0 ? (int)a1 : -1 };
+        forEachSeries(visitSnap, &q);
+        qsort(q.snaps, q.count, sizeof(NodeSnap), cmpNodeSnap);
 
-                printf("📡 Node%d -> %s\n", nodeId, logBuf);
-                logToFile(nodeId, "DATA", logBuf);
+        if (strcmp(cmd, "NODE") == 0) {
+            if (q.count) jsonNode(out, &q.snaps[0]);
+            else sbPrintf(out, "{\"error\":\"Node not found\"}");
+        } else if (strcmp(cmd, "NODES") == 0) {
+            sbPrintf(out, "[");
+            for (int i = 0; i < q.count; i++) {
+                if (i) sbPrintf(out, ",");
+                jsonNode(out, &q.snaps[i]);
             }
-            else {
-                /* fallback */
-                printf("📡 Node%d -> %s\n", nodeId, buffer);
-                logToFile(nodeId, "DATA", buffer);
+            sbPrintf(out, "]");
+        } else {
+            unsigned long long readings = 0;
+            int regs = 0, active = 0;
+            double temp = 0, hum = 0;
+            for (int i = 0; i < q.count; i++) {
+                const Series *s = &q.snaps[i].s;
+                readings += s->total;
+                regs += s->registrations;
+                active += q.snaps[i].active;
+                temp += s->agg[METRIC_TEMP].sum / s->total;
+                hum += s->agg[METRIC_HUM].sum / s->total;
             }
+            int nodes = q.count ? q.count : 1;
+            sbPrintf(out, "{\"totalNodes\":%d,\"totalReadings\":%llu,"
+                          "\"totalRegistrations\":%d,\"totalErrors\":%lu,"
+                          "\"activeNodes\":%d,\"avgTemperature\":%.2f,"
+                          "\"avgHumidity\":%.2f}",
+                     q.count, readings, regs, atomic_load(&malformedFrames),
+                     active, temp / nodes, hum / nodes);
+        }
+        free(q.snaps);
+        return;
+    }
+
+    sbPrintf(out, "{\"error\":\"unknown command\"}");
+}
+
+/* ================= STATS PAGE =================
+ * metrics.h counters and histograms plus gauges read at scrape time.
+ * Node counts come from the lock-free record fields, so a scrape
+ * never waits on an ingest worker.
+ */
+void renderStats(StrBuf *out) {
+    int registered = 0, active = 0;
+    for (int k = 0; k < workerCount; k++) {
+        Registry *reg = &workers[k].reg;
+        for (int i = 0; i < registryCount(reg); i++) {
+            Client *c = registryAt(reg, i);
+            registered += clientBound(c);
+            active += atomic_load(&c->active);
+        }
+    }
+
+    sbPrintf(out, "# HELP sensor_nodes Nodes known to the server\n"
+                  "# TYPE sensor_nodes gauge\n"
+                  "sensor_nodes{state=\"registered\"} %d\n"
+                  "sensor_nodes{state=\"active\"} %d\n", registered, active);
+    sbPrintf(out, "# HELP sensor_workers Ingest worker threads\n"
+                  "# TYPE sensor_workers gauge\nsensor_workers %d\n", workerCount);
+    sbPrintf(out, "# HELP sensor_log_dropped_total Log entries dropped on a full buffer\n"
+                  "# TYPE sensor_log_dropped_total counter\nsensor_log_dropped_total %lu\n",
+             atomic_load(&logDropped));
+    metricsRender(out);
+}
+
+/* ---------- PARSE ARGS ---------- */
+void parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workers") == 0) &&
+            i + 1 < argc) {
+            workerCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fsync-ms") == 0 && i + 1 < argc) {
+            fsyncMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tick-ms") == 0 && i + 1 < argc) {
+            tickMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--query-port") == 0 && i + 1 < argc) {
+            queryPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--series") == 0 && i + 1 < argc) {
+            seriesCapacity = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--segments") == 0 && i + 1 < argc) {
+            segmentDir = argv[++i];
+        } else if (strcmp(argv[i], "--no-segments") == 0) {
+            segmentDir = NULL;
+        } else if (strcmp(argv[i], "--segment-mb") == 0 && i + 1 < argc) {
+            segmentBytes = atol(argv[++i]) * 1024 * 1024;
+        } else if (strcmp(argv[i], "--log-rotate-mb") == 0 && i + 1 < argc) {
+            rotateMb = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--log-rotate-hours") == 0 && i + 1 < argc) {
+            rotateHours = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--log-keep") == 0 && i + 1 < argc) {
+            keepFiles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--log-keep-days") == 0 && i + 1 < argc) {
+            keepDays = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats-port") == 0 && i + 1 < argc) {
+            statsPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--alert-port") == 0 && i + 1 < argc) {
+            alertPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--debug-sample") == 0 && i + 1 < argc) {
+            debugSample = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [-w|--workers N] [--fsync-ms MS] [--tick-ms MS]\n"
+                   "          [--query-port PORT (0 = off)] [--series READINGS]\n"
+                   "          [--segments DIR | --no-segments] [--segment-mb MB]\n"
+                   "          [--log-rotate-mb MB] [--log-rotate-hours H] (0 = off)\n"
+                   "          [--log-keep FILES] [--log-keep-days DAYS] (0 = no limit,\n"
+                   "           applied to rotated logs and to segments)\n"
+                   "          [--stats-port PORT (0 = off)] [--alert-port PORT (0 = off)]\n"
+                   "          [--debug-sample N]\n",
+                   argv[0]);
+            exit(1);
         }
     }
 
-    closesocket(serverSocket);
-    WSACleanup();
-    DeleteCriticalSection(&cs);
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > MAX_WORKERS) workerCount = MAX_WORKERS;
+    if (tickMs < 1) tickMs = 1;
+    if (seriesCapacity < 1) seriesCapacity = 1;
+#ifdef _WIN32
+    workerCount = 1;    // no SO_REUSEPORT on Windows
+#endif
+}
+
+/* ================= MAIN ================= */
+int main(int argc, char **argv) {
+    parseArgs(argc, argv);
+    netInit();
+
+    logSegments(segmentDir, segmentBytes);
+    logRotation(rotateMb >= 0 ? rotateMb * 1024 * 1024 : -1,
+                rotateHours >= 0 ? rotateHours * 3600 : -1,
+                keepFiles, keepDays);
+    if (logInit(LOG_FILE, fsyncMs) != 0) {
+        printf("❌ Cannot start log writer\n");
+        return 1;
+    }
+
+    workers = calloc(workerCount, sizeof(Worker));
+    if (!workers) return 1;
+    mutexInit(&policyCs);
+
+    for (int k = 0; k < workerCount; k++) {
+        Worker *w = &workers[k];
+        char name[24];
+        w->id = k;
+        snprintf(name, sizeof(name), "worker%d", k);
+        w->m = metricsRegister(name);
+        mutexInit(&w->cs);
+        if (registryInit(&w->reg) != 0 ||
+            wheelInit(&w->wheel, tickMs, CLIENT_TIMEOUT * 1000, nowMs()) != 0)
+            return 1;
+
+        w->sock = udpOpen(SERVER_PORT,
+                          NET_NONBLOCK | (workerCount > 1 ? NET_REUSEPORT : 0));
+        if (w->sock == INVALID_SOCK) {
+            printf("❌ Cannot bind port %d\n", SERVER_PORT);
+            return 1;
+        }
+    }
+
+    /* before the workers: alertPublish() reads alertOn unlocked */
+    if (alertPort > 0) {
+        if (alertStart((unsigned short)alertPort) == 0)
+            printf("🚨 Flood alerts on 127.0.0.1:%d\n", alertPort);
+        else
+            printf("⚠️ Cannot open alert port %d\n", alertPort);
+    }
+
+    for (int k = 1; k < workerCount; k++)
+        startThread(workerLoop, &workers[k]);
+
+    if (queryPort > 0) {
+        if (queryStart((unsigned short)queryPort, handleQuery) == 0)
+            printf("🔎 Query socket on 127.0.0.1:%d\n", queryPort);
+        else
+            printf("⚠️ Cannot open query port %d\n", queryPort);
+    }
+
+    if (statsPort > 0) {
+        if (statsStart((unsigned short)statsPort, renderStats) == 0)
+            printf("📈 Stats on http://127.0.0.1:%d/metrics\n", statsPort);
+        else
+            printf("⚠️ Cannot open stats port %d\n", statsPort);
+    }
+
+    printf("✅ Server running on port %d (%d worker%s)\n",
+           SERVER_PORT, workerCount, workerCount > 1 ? "s" : "");
+
+    workerLoop(&workers[0]);
+
+    for (int k = 0; k < workerCount; k++) {
+        sockClose(workers[k].sock);
+        for (int i = 0; i < registryCount(&workers[k].reg); i++)
+            seriesFree(registryAt(&workers[k].reg, i)->series);
+        registryFree(&workers[k].reg);
+        wheelFree(&workers[k].wheel);
+        mutexDestroy(&workers[k].cs);
+    }
+    free(workers);
+    netCleanup();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,217 @@
+/* ================= SHARED-MEMORY READING RING =================
+ * Hands readings from the node that owns the Arduino to the other
+ * node processes on the same machine, instead of them polling
+ * shared_data.txt (still written for nodes that read the file).
+ *
+ * One producer, any number of consumers, no locks. The ring lives in
+ * POSIX shared memory (/dev/shm<name>). Reading n goes to slot
+ * n % SHM_SLOTS: the slot's seq is 0 while it is being written and
+ * n + 1 once it is complete, then head moves to n + 1. Each consumer
+ * keeps its own cursor, so every consumer sees every reading once;
+ * one that falls more than SHM_SLOTS behind skips ahead and counts
+ * what it missed. The payload is the 16-byte wire reading
+ * (protocol.h) held in two atomic words, and a consumer re-checks
+ * seq after copying it, so a slot overwritten mid-read is detected.
+ *
+ * Wakeups: the producer bumps `wake` and futex-wakes it only if a
+ * consumer is parked. A consumer parks in a helper thread that turns
+ * the futex into an eventfd its Poller can wait on.
+ *
+ * Linux only; elsewhere SHM_SUPPORTED is 0 and nodes use the file.
+ */
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include "platform.h"
+#include "protocol.h"
+#include <stdatomic.h>
+
+#define SHM_NAME    "/sensor_readings"
+#define SHM_MAGIC   0x474E5253u         // "SRNG"
+#define SHM_VERSION 1
+#define SHM_SLOTS   1024
+#define SHM_PARK_MS 1000                // consumer re-checks this often
+
+typedef struct {
+    _Atomic uint64_t seq;               // n + 1 when reading n is complete
+    _Atomic uint64_t word[2];
+} ShmSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    _Atomic uint64_t head;              // next reading number
+    _Atomic uint32_t wake;              // futex word, bumped per reading
+    _Atomic uint32_t waiters;           // consumers parked on wake
+    ShmSlot slots[SHM_SLOTS];
+} ShmRing;
+
+typedef struct {
+    ShmRing *ring;
+    uint64_t cursor;                    // next reading to take
+    uint64_t missed;                    // overwritten before we got to them
+    int eventFd;                        // readable after a publish
+} ShmReader;
+
+#ifdef __linux__
+#define SHM_SUPPORTED 1
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+static inline void futexWait(_Atomic uint32_t *word, uint32_t expected, int timeoutMs) {
+    struct timespec ts = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &ts, NULL, 0);
+}
+
+static inline void futexWake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline ShmRing *shmMap(const char *name, int create) {
+    int fd = shm_open(name, create ? O_RDWR | O_CREAT : O_RDWR, 0666);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (create ? ((size_t)st.st_size != sizeof(ShmRing) &&
+                   ftruncate(fd, sizeof(ShmRing)) != 0)
+                : (size_t)st.st_size < sizeof(ShmRing))) {
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, sizeof(ShmRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : (ShmRing*)p;
+}
+
+/* ---------- PRODUCER ----------
+ * A ring left by an earlier run is reused, head included, so
+ * consumers that stayed attached carry on.
+ */
+static inline ShmRing *shmRingCreate(const char *name) {
+    ShmRing *ring = shmMap(name, 1);
+    if (ring && (ring->magic != SHM_MAGIC || ring->version != SHM_VERSION)) {
+        memset(ring, 0, sizeof(*ring));
+        ring->version = SHM_VERSION;
+        atomic_thread_fence(memory_order_release);
+        ring->magic = SHM_MAGIC;
+    }
+    return ring;
+}
+
+static inline void shmRingPublish(ShmRing *ring, const Reading *r) {
+    unsigned char buf[READING_SIZE];
+    putReading(buf, r);
+
+    uint64_t n = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ShmSlot *s = &ring->slots[n % SHM_SLOTS];
+
+    atomic_store_explicit(&s->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&s->word[0], get64(buf), memory_order_relaxed);
+    atomic_store_explicit(&s->word[1], get64(buf + 8), memory_order_relaxed);
+    atomic_store_explicit(&s->seq, n + 1, memory_order_release);
+    atomic_store_explicit(&ring->head, n + 1, memory_order_release);
+
+    atomic_fetch_add(&ring->wake, 1);
+    if (atomic_load(&ring->waiters))
+        futexWake(&ring->wake);
+}
+
+/* ---------- CONSUMER ---------- */
+static THREAD_FUNC(shmParker) {
+    ShmReader *rd = (ShmReader*)arg;
+    uint32_t seen = atomic_load(&rd->ring->wake);
+    uint64_t one = 1;
+
+    while (1) {
+        atomic_fetch_add(&rd->ring->waiters, 1);
+        futexWait(&rd->ring->wake, seen, SHM_PARK_MS);
+        atomic_fetch_sub(&rd->ring->waiters, 1);
+
+        uint32_t now = atomic_load(&rd->ring->wake);
+        if (now != seen) {
+            seen = now;
+            if (write(rd->eventFd, &one, sizeof(one)) < 0) break;
+        }
+    }
+    THREAD_RETURN;
+}
+
+/* Attaches to a ring the producer has set up; starts at its head.
+ * Returns 0 on success.
+ */
+static inline int shmReaderOpen(ShmReader *rd, const char *name) {
+    memset(rd, 0, sizeof(*rd));
+    rd->ring = shmMap(name, 0);
+    if (!rd->ring) return -1;
+    if (rd->ring->magic != SHM_MAGIC || rd->ring->version != SHM_VERSION) {
+        munmap(rd->ring, sizeof(ShmRing));
+        return -1;
+    }
+
+    rd->cursor = atomic_load_explicit(&rd->ring->head, memory_order_acquire);
+    rd->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (rd->eventFd < 0 || startThread(shmParker, rd) != 0) {
+        munmap(rd->ring, sizeof(ShmRing));
+        return -1;
+    }
+    return 0;
+}
+
+/* Clears the wakeup; call before draining with shmReaderNext(). */
+static inline void shmReaderClear(ShmReader *rd) {
+    uint64_t count;
+    while (read(rd->eventFd, &count, sizeof(count)) > 0) {}
+}
+
+/* Returns 1 and the next reading, 0 when caught up. */
+static inline int shmReaderNext(ShmReader *rd, Reading *out) {
+    ShmRing *ring = rd->ring;
+
+    while (1) {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (rd->cursor >= head) {
+            rd->cursor = head;          // ring was re-created
+            return 0;
+        }
+        if (head - rd->cursor > SHM_SLOTS) {
+            rd->missed += head - SHM_SLOTS - rd->cursor;
+            rd->cursor = head - SHM_SLOTS;
+        }
+
+        ShmSlot *s = &ring->slots[rd->cursor % SHM_SLOTS];
+        unsigned char buf[READING_SIZE];
+        uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        put64(buf, atomic_load_explicit(&s->word[0], memory_order_relaxed));
+        put64(buf + 8, atomic_load_explicit(&s->word[1], memory_order_relaxed));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (seq == rd->cursor + 1 &&
+            atomic_load_explicit(&s->seq, memory_order_relaxed) == seq) {
+            getReading(buf, out);
+            rd->cursor++;
+            return 1;
+        }
+        rd->missed++;                   // lapped while reading it
+        rd->cursor++;
+    }
+}
+
+#else
+#define SHM_SUPPORTED 0
+
+static inline ShmRing *shmRingCreate(const char *name) { (void)name; return NULL; }
+static inline void shmRingPublish(ShmRing *ring, const Reading *r) { (void)ring; (void)r; }
+static inline int shmReaderOpen(ShmReader *rd, const char *name) { (void)rd; (void)name; return -1; }
+static inline void shmReaderClear(ShmReader *rd) { (void)rd; }
+static inline int shmReaderNext(ShmReader *rd, Reading *out) { (void)rd; (void)out; return 0; }
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+/* ================= TIMER WHEEL =================
+ * Hashed timing wheel for node liveness. Every registry record can
+ * hold one deadline; schedule / reschedule / cancel are O(1) list
+ * splices, and advancing the wheel only walks the slots whose tick
+ * has come, so idle nodes that keep heartbeating are never scanned.
+ *
+ * Timers are keyed by registry index. Links live in a parallel array
+ * that grows with the registry. The wheel spans at least spanMs, so
+ * a deadline inside the span never needs more than one lap; longer
+ * deadlines simply stay in their slot until their tick comes round.
+ *
+ * Not thread safe: each worker owns one wheel next to its Registry.
+ */
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "platform.h"
+
+#define WHEEL_NIL (-1)
+
+typedef struct {
+    int32_t prev;
+    int32_t next;
+    int32_t slot;       // WHEEL_NIL = not scheduled
+    uint64_t due;       // absolute tick
+} WheelLink;
+
+typedef struct {
+    int32_t *heads;
+    uint32_t mask;
+    WheelLink *links;
+    int cap;
+    int count;          // scheduled timers
+
+    uint64_t tickMs;
+    uint64_t startMs;
+    uint64_t tick;      // next tick to fire
+    uint64_t nextDue;   // no timer is due before this tick
+} TimerWheel;
+
+typedef void (*WheelFire)(void *ctx, int idx);
+
+/* ---------- INIT / FREE ---------- */
+static inline int wheelInit(TimerWheel *tw, uint32_t tickMs, uint32_t spanMs,
+                            uint64_t now) {
+    memset(tw, 0, sizeof(*tw));
+    if (tickMs == 0) tickMs = 1;
+
+    uint32_t slots = 16;
+    while (slots < spanMs / tickMs + 2)
+        slots <<= 1;
+
+    tw->heads = malloc(slots * sizeof(int32_t));
+    if (!tw->heads) return -1;
+    for (uint32_t i = 0; i < slots; i++)
+        tw->heads[i] = WHEEL_NIL;
+
+    tw->mask = slots - 1;
+    tw->tickMs = tickMs;
+    tw->startMs = now;
+    tw->tick = 1;
+    tw->nextDue = 1;
+    return 0;
+}
+
+static inline void wheelFree(TimerWheel *tw) {
+    free(tw->heads);
+    free(tw->links);
+    memset(tw, 0, sizeof(*tw));
+}
+
+static inline int wheelReserve(TimerWheel *tw, int idx) {
+    if (idx < tw->cap) return 0;
+
+    int cap = tw->cap ? tw->cap : 16;
+    while (cap <= idx) cap *= 2;
+
+    WheelLink *links = realloc(tw->links, cap * sizeof(WheelLink));
+    if (!links) return -1;
+    for (int i = tw->cap; i < cap; i++)
+        links[i].slot = WHEEL_NIL;
+
+    tw->links = links;
+    tw->cap = cap;
+    return 0;
+}
+
+/* ---------- CANCEL ---------- */
+static inline void wheelCancel(TimerWheel *tw, int idx) {
+    if (idx >= tw->cap) return;
+    WheelLink *l = &tw->links[idx];
+    if (l->slot == WHEEL_NIL) return;
+
+    if (l->prev != WHEEL_NIL) tw->links[l->prev].next = l->next;
+    else                      tw->heads[l->slot] = l->next;
+    if (l->next != WHEEL_NIL) tw->links[l->next].prev = l->prev;
+
+    l->slot = WHEEL_NIL;
+    tw->count--;
+}
+
+/* ---------- SCHEDULE ----------
+ * (Re)arms idx to fire at dueMs (monotonic ms). Returns -1 on OOM.
+ */
+static inline int wheelSchedule(TimerWheel *tw, int idx, uint64_t dueMs) {
+    if (wheelReserve(tw, idx) != 0) return -1;
+    wheelCancel(tw, idx);
+
+    uint64_t due = dueMs > tw->startMs
+                 ? (dueMs - tw->startMs + tw->tickMs - 1) / tw->tickMs
+                 : 0;
+    if (due < tw->tick) due = tw->tick;
+    if (due < tw->nextDue) tw->nextDue = due;
+
+    WheelLink *l = &tw->links[idx];
+    l->due = due;
+    l->slot = (int32_t)(due & tw->mask);
+    l->prev = WHEEL_NIL;
+    l->next = tw->heads[l->slot];
+    if (l->next != WHEEL_NIL) tw->links[l->next].prev = idx;
+    tw->heads[l->slot] = idx;
+    tw->count++;
+    return 0;
+}
+
+/* ---------- NEXT TIMEOUT ----------
+ * Milliseconds until the earliest armed deadline, -1 if nothing is
+ * armed. Looks ahead from nextDue, at most one lap, for the first
+ * slot holding a timer due on that tick; the result is kept as the
+ * new nextDue, so an idle wheel is not rescanned on every call.
+ * Cancelling only leaves nextDue early, which costs one spare wakeup.
+ */
+static inline int wheelNextTimeout(TimerWheel *tw, uint64_t now) {
+    if (tw->count == 0) return -1;
+
+    uint64_t t = tw->nextDue > tw->tick ? tw->nextDue : tw->tick;
+    uint64_t lap = tw->tick + tw->mask + 1;
+    for (; t < lap; t++) {
+        int32_t i = tw->heads[t & tw->mask];
+        while (i != WHEEL_NIL && tw->links[i].due != t)
+            i = tw->links[i].next;
+        if (i != WHEEL_NIL) break;
+    }
+    tw->nextDue = t;            // nothing found: every timer is a lap away
+
+    uint64_t at = tw->startMs + t * tw->tickMs;
+    return at > now ? (int)(at - now) : 0;
+}
+
+/* ---------- ADVANCE ----------
+ * Fires every timer whose tick has passed. fire() may cancel other
+ * timers but must not rearm one for the tick being fired.
+ * Returns the number fired.
+ */
+static inline int wheelAdvance(TimerWheel *tw, uint64_t now,
+                               WheelFire fire, void *ctx) {
+    uint64_t target = now > tw->startMs ? (now - tw->startMs) / tw->tickMs : 0;
+    int fired = 0;
+
+    if (tw->count == 0) {
+        /* nothing armed: jump straight to the present */
+        if (target >= tw->tick) tw->tick = target + 1;
+        return 0;
+    }
+
+    /* skip the ticks before the earliest deadline */
+    if (tw->tick < tw->nextDue)
+        tw->tick = tw->nextDue <= target ? tw->nextDue : target + 1;
+
+    while (tw->tick <= target) {
+        int32_t i = tw->heads[tw->tick & tw->mask];
+        while (i != WHEEL_NIL) {
+            int32_t next = tw->links[i].next;
+            if (tw->links[i].due <= tw->tick) {
+                wheelCancel(tw, i);
+                fire(ctx, i);
+                fired++;
+                /* fire() may have cancelled next; restart the slot */
+                next = tw->heads[tw->tick & tw->mask];
+            }
+            i = next;
+        }
+        tw->tick++;
+        if (tw->count == 0 && target >= tw->tick) tw->tick = target + 1;
+    }
+    return fired;
+}
+
+#endif
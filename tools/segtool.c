@@ -0,0 +1,176 @@
+/* ================= SEGMENT TOOL =================
+ * Backfills binary segments (segment.h) from existing text logs and
+ * runs indexed range queries against a segment directory.
+ *
+ * Build: gcc -O2 tools/segtool.c -o segtool -lpthread
+ * Usage: ./segtool convert [-o DIR] [--segment-mb MB] LOG...
+ *        ./segtool query [DIR] [--node N] [--from UNIX] [--to UNIX] [--limit N]
+ */
+#include "../platform.h"
+#include "../segment.h"
+#include "../kvparse.h"
+#include <time.h>
+
+/* ---------- PARSE ONE TEXT LINE ----------
+ * "[YYYY-MM-DD HH:MM:SS] Node%d EVENT -> data". Very old logs omit
+ * the NodeN part; like api.js, those inherit the last node seen.
+ * Returns 1 if r was filled.
+ */
+static int parseLine(const char *line, int *lastNode, SegRecord *r) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int used = 0;
+
+    if (sscanf(line, "[%d-%d-%d %d:%d:%d]%n",
+               &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &used) != 6 || !used)
+        return 0;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    time_t when = mktime(&tm);
+    if (when == (time_t)-1) return 0;
+
+    const char *p = line + used;
+    while (*p == ' ') p++;
+
+    int node, n = 0;
+    if (sscanf(p, "Node%d %n", &node, &n) == 1 && n) {
+        *lastNode = node;
+        p += n;
+    }
+
+    const char *arrow = strstr(p, " -> ");
+    if (!arrow || arrow == p) return 0;
+
+    char event[16];
+    size_t len = (size_t)(arrow - p);
+    if (len >= sizeof(event)) return 0;
+    memcpy(event, p, len);
+    event[len] = '\0';
+
+    memset(r, 0, sizeof(*r));
+    r->timeMs = (uint64_t)when * 1000;
+    r->nodeId = (uint32_t)*lastNode;
+    r->event = segEventCode(event);
+
+    if (r->event == SEG_DATA) {
+        KvField f[KV_MAX_FIELDS];
+        int n = kvParse(arrow + 4, strlen(arrow + 4), f, KV_MAX_FIELDS);
+        if (kvReading(f, n, &r->reading) != SENSOR_ALL)
+            return 0;
+    }
+    return 1;
+}
+
+/* ---------- CONVERT ---------- */
+static int convert(int argc, char **argv) {
+    const char *dir = SEG_DIR;
+    long maxBytes = SEG_MAX_BYTES;
+    int first = argc;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--segment-mb") == 0 && i + 1 < argc)
+            maxBytes = atol(argv[++i]) * 1024 * 1024;
+        else { first = i; break; }
+    }
+    if (first >= argc) {
+        printf("convert: no log files given\n");
+        return 1;
+    }
+
+    SegWriter w;
+    if (segWriterInit(&w, dir, maxBytes) != 0) {
+        printf("❌ Cannot create %s\n", dir);
+        return 1;
+    }
+
+    unsigned long records = 0, skipped = 0;
+    uint64_t start = nowMs();
+
+    for (int i = first; i < argc; i++) {
+        FILE *fp = fopen(argv[i], "r");
+        if (!fp) {
+            printf("⚠️ Cannot open %s\n", argv[i]);
+            continue;
+        }
+
+        char line[1024];
+        int lastNode = 0;
+        while (fgets(line, sizeof(line), fp)) {
+            SegRecord r;
+            if (parseLine(line, &lastNode, &r) && segAppend(&w, &r) == 0)
+                records++;
+            else if (line[0] != '\n' && line[0] != '\r')
+                skipped++;
+        }
+        fclose(fp);
+    }
+    segClose(&w);
+
+    printf("✅ %lu records written to %s (%lu lines skipped) in %llu ms\n",
+           records, dir, skipped, (unsigned long long)(nowMs() - start));
+    return 0;
+}
+
+/* ---------- QUERY ---------- */
+typedef struct {
+    unsigned long matched;
+    unsigned long limit;
+} PrintCtx;
+
+static int printRecord(void *ctx, const SegRecord *r) {
+    PrintCtx *pc = (PrintCtx*)ctx;
+    char ts[64];
+    time_t when = (time_t)(r->timeMs / 1000);
+    struct tm *t = localtime(&when);
+    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", t);
+
+    if (r->event == SEG_DATA)
+        printf("[%s] Node%u DATA -> TEMP=%.2f HUM=%.2f SOIL=%d WATER=%d\n",
+               ts, r->nodeId, r->reading.temp, r->reading.hum,
+               r->reading.soil, r->reading.water);
+    else
+        printf("[%s] Node%u %s\n", ts, r->nodeId, segEventName(r->event));
+
+    return ++pc->matched >= pc->limit;
+}
+
+static int query(int argc, char **argv) {
+    const char *dir = SEG_DIR;
+    PrintCtx pc = { 0, (unsigned long)-1 };
+    SegQuery q = { 0, UINT64_MAX, -1, printRecord, &pc };
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--node") == 0 && i + 1 < argc)
+            q.nodeId = atol(argv[++i]);
+        else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc)
+            q.fromMs = (uint64_t)atoll(argv[++i]) * 1000;
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc)
+            q.toMs = (uint64_t)atoll(argv[++i]) * 1000 + 999;
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc)
+            pc.limit = strtoul(argv[++i], NULL, 10);
+        else
+            dir = argv[i];
+    }
+
+    uint64_t start = nowMs();
+    segQueryDir(dir, &q);
+    fprintf(stderr, "%lu records in %llu ms\n",
+            pc.matched, (unsigned long long)(nowMs() - start));
+    return 0;
+}
+
+/* ================= MAIN ================= */
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "convert") == 0)
+        return convert(argc - 2, argv + 2);
+    if (argc >= 2 && strcmp(argv[1], "query") == 0)
+        return query(argc - 2, argv + 2);
+
+    printf("Usage: %s convert [-o DIR] [--segment-mb MB] LOG...\n"
+           "       %s query [DIR] [--node N] [--from UNIX] [--to UNIX] [--limit N]\n",
+           argv[0], argv[0]);
+    return 1;
+}
@@ -0,0 +1,403 @@
+/* ================= TIME-SERIES STORE =================
+ * Recent readings per node, kept in memory so queries never have to
+ * re-read server_log.txt. Each node owns one Series: a ring of its
+ * last SERIES_CAPACITY readings stored column by column (time, temp,
+ * hum, soil, water), plus running totals over every reading the node
+ * has sent since the server started.
+ *
+ * Each series also keeps downsampled rollups in three tiers (1 min,
+ * 1 h, 1 day buckets) with count, sum, min, max and last per metric,
+ * so a month-long chart reads hundreds of buckets, not every reading.
+ *
+ * Rings start small and double up to the capacity, so thousands of
+ * quiet nodes cost little. Series hang off registry records and are
+ * guarded by the same shard lock; not thread safe on their own.
+ */
+#ifndef TSSTORE_H
+#define TSSTORE_H
+
+#include "platform.h"
+#include "seqtrack.h"
+#include "flood.h"
+
+#define SERIES_CAPACITY 512     // default readings kept per node
+#define SERIES_INITIAL  16
+
+enum { METRIC_TEMP, METRIC_HUM, METRIC_SOIL, METRIC_WATER, METRIC_COUNT };
+
+typedef struct {
+    double sum;
+    double min;
+    double max;
+} MetricAgg;
+
+typedef struct {
+    int64_t timeMs;
+    float temp;
+    float hum;
+    int32_t soil;
+    int32_t water;
+} SeriesRow;
+
+/* ---------- ROLLUP TIERS ---------- */
+#define ROLLUP_TIERS 3
+
+typedef struct {
+    int64_t startMs;        // bucket start, aligned to the tier span
+    int64_t firstMs;        // first / last reading inside the bucket
+    int64_t lastMs;
+    uint32_t count;
+    float min[METRIC_COUNT];
+    float max[METRIC_COUNT];
+    float last[METRIC_COUNT];
+    double sum[METRIC_COUNT];
+} RollupBucket;
+
+typedef struct {
+    RollupBucket *b;        // ring, oldest at head
+    int alloc;
+    int head;
+    int count;
+} RollupTier;
+
+static const struct {
+    const char *name;
+    int64_t spanMs;
+    int keep;               // buckets retained
+} rollupTiers[ROLLUP_TIERS] = {
+    { "1m", 60 * 1000LL,           24 * 60 },     // one day
+    { "1h", 60 * 60 * 1000LL,      31 * 24 },     // one month
+    { "1d", 24 * 60 * 60 * 1000LL, 366 }          // one year
+};
+
+typedef struct Series {
+    int nodeId;
+
+    /* ring, oldest at (head - count) */
+    int cap;
+    int head;
+    int count;
+    int64_t *timeMs;
+    float *temp;
+    float *hum;
+    int32_t *soil;
+    int32_t *water;
+
+    /* lifetime totals */
+    uint64_t total;
+    int64_t firstMs;
+    int64_t lastMs;
+    MetricAgg agg[METRIC_COUNT];
+
+    RollupTier tiers[ROLLUP_TIERS];
+
+    int registrations;
+    char lastEvent[16];
+
+    SeqTrack seq;           // loss / reorder / duplicate accounting
+    FloodState flood;       // flood rule state (flood.h)
+} Series;
+
+static int seriesCapacity = SERIES_CAPACITY;
+
+/* ---------- ALLOC ---------- */
+static inline int seriesResize(Series *s, int cap) {
+    int64_t *t = malloc(cap * sizeof(int64_t));
+    float *te = malloc(cap * sizeof(float));
+    float *hu = malloc(cap * sizeof(float));
+    int32_t *so = malloc(cap * sizeof(int32_t));
+    int32_t *wa = malloc(cap * sizeof(int32_t));
+    if (!t || !te || !hu || !so || !wa) {
+        free(t); free(te); free(hu); free(so); free(wa);
+        return -1;
+    }
+
+    /* unroll the old ring so the new one starts at 0 */
+    for (int i = 0; i < s->count; i++) {
+        int j = (s->head - s->count + i + s->cap) % s->cap;
+        t[i] = s->timeMs[j];
+        te[i] = s->temp[j];
+        hu[i] = s->hum[j];
+        so[i] = s->soil[j];
+        wa[i] = s->water[j];
+    }
+
+    free(s->timeMs); free(s->temp); free(s->hum); free(s->soil); free(s->water);
+    s->timeMs = t;
+    s->temp = te;
+    s->hum = hu;
+    s->soil = so;
+    s->water = wa;
+    s->cap = cap;
+    s->head = s->count % cap;
+    return 0;
+}
+
+static inline Series *seriesNew(int nodeId) {
+    Series *s = calloc(1, sizeof(Series));
+    if (!s) return NULL;
+    s->nodeId = nodeId;
+    strcpy(s->lastEvent, "UNKNOWN");
+
+    int cap = SERIES_INITIAL < seriesCapacity ? SERIES_INITIAL : seriesCapacity;
+    if (seriesResize(s, cap) != 0) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+static inline void seriesFree(Series *s) {
+    if (!s) return;
+    for (int t = 0; t < ROLLUP_TIERS; t++)
+        free(s->tiers[t].b);
+    free(s->timeMs); free(s->temp); free(s->hum); free(s->soil); free(s->water);
+    free(s);
+}
+
+/* ---------- ROLLUP ---------- */
+static inline RollupBucket *tierAt(const RollupTier *t, int k) {
+    return &t->b[(t->head + k) % t->alloc];
+}
+
+/* Makes room for one more bucket: grow, or drop the oldest once the
+   tier holds `keep`. Returns -1 only on OOM with nothing to drop. */
+static inline int tierReserve(RollupTier *t, int keep) {
+    if (t->count < t->alloc) return 0;
+
+    if (t->alloc < keep) {
+        int alloc = t->alloc ? t->alloc * 2 : 8;
+        if (alloc > keep) alloc = keep;
+        RollupBucket *b = malloc(alloc * sizeof(RollupBucket));
+        if (b) {
+            for (int k = 0; k < t->count; k++)
+                b[k] = *tierAt(t, k);
+            free(t->b);
+            t->b = b;
+            t->alloc = alloc;
+            t->head = 0;
+            return 0;
+        }
+        if (!t->count) return -1;
+    }
+
+    t->head = (t->head + 1) % t->alloc;
+    t->count--;
+    return 0;
+}
+
+/* First bucket with startMs >= start. */
+static inline int tierSeek(const RollupTier *t, int64_t start) {
+    int lo = 0, hi = t->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tierAt(t, mid)->startMs < start) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static inline void bucketAdd(RollupBucket *b, int64_t timeMs, const float *v) {
+    if (b->count == 0) {
+        b->firstMs = b->lastMs = timeMs;
+        for (int m = 0; m < METRIC_COUNT; m++) {
+            b->min[m] = b->max[m] = v[m];
+            b->sum[m] = 0;
+        }
+    }
+    if (timeMs < b->firstMs) b->firstMs = timeMs;
+    if (timeMs >= b->lastMs) {
+        b->lastMs = timeMs;
+        for (int m = 0; m < METRIC_COUNT; m++) b->last[m] = v[m];
+    }
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        if (v[m] < b->min[m]) b->min[m] = v[m];
+        if (v[m] > b->max[m]) b->max[m] = v[m];
+        b->sum[m] += v[m];
+    }
+    b->count++;
+}
+
+/* Readings normally land in the newest bucket; late ones from a
+   batching node find theirs by binary search, or get a new bucket
+   slotted into place. Ones older than the tier keeps are dropped. */
+static inline void tierAdd(RollupTier *t, int keep, int64_t spanMs,
+                           int64_t timeMs, const float *v) {
+    int64_t start = timeMs - ((timeMs % spanMs) + spanMs) % spanMs;
+
+    if (t->count && tierAt(t, t->count - 1)->startMs == start) {
+        bucketAdd(tierAt(t, t->count - 1), timeMs, v);
+        return;
+    }
+
+    int k = tierSeek(t, start);
+    if (k < t->count && tierAt(t, k)->startMs == start) {
+        bucketAdd(tierAt(t, k), timeMs, v);
+        return;
+    }
+    if (k == 0 && t->count == keep) return;     // older than retention
+
+    int before = t->count;
+    if (tierReserve(t, keep) != 0) return;
+    if (t->count < before && k > 0) k--;        // oldest was dropped
+
+    /* shift [k, count) up by one */
+    for (int j = t->count; j > k; j--)
+        *tierAt(t, j) = *tierAt(t, j - 1);
+    t->count++;
+
+    RollupBucket *b = tierAt(t, k);
+    memset(b, 0, sizeof(*b));
+    b->startMs = start;
+    bucketAdd(b, timeMs, v);
+}
+
+/* ---------- APPEND ---------- */
+static inline void metricAdd(MetricAgg *a, double v, int first) {
+    if (first) {
+        a->min = a->max = v;
+    } else {
+        if (v < a->min) a->min = v;
+        if (v > a->max) a->max = v;
+    }
+    a->sum += v;
+}
+
+/* ring slot of row k (0 = oldest) */
+static inline int seriesSlot(const Series *s, int k) {
+    return (s->head - s->count + k + s->cap) % s->cap;
+}
+
+static inline void seriesMove(Series *s, int to, int from) {
+    s->timeMs[to] = s->timeMs[from];
+    s->temp[to] = s->temp[from];
+    s->hum[to] = s->hum[from];
+    s->soil[to] = s->soil[from];
+    s->water[to] = s->water[from];
+}
+
+/* The ring is kept in time order, which seriesRange() and the LATEST
+   query rely on. Readings usually arrive in order; a late one (an
+   older BATCH frame, a selective-ack retransmit) is slotted in behind
+   the newer rows, which sit near the head, so the shift is short. A
+   late reading older than everything in a full ring only counts
+   toward the totals and rollups. */
+static inline void seriesAppend(Series *s, int64_t timeMs, float temp,
+                                float hum, int soil, int water) {
+    if (s->count == s->cap && s->cap < seriesCapacity) {
+        int cap = s->cap * 2;
+        if (cap > seriesCapacity) cap = seriesCapacity;
+        seriesResize(s, cap);   // on OOM keep overwriting the old ring
+    }
+
+    int k = s->count;
+    while (k > 0 && s->timeMs[seriesSlot(s, k - 1)] > timeMs) k--;
+
+    if (k > 0 || s->count < s->cap) {
+        if (s->count == s->cap) {   // drop the oldest row
+            s->count--;
+            k--;
+        }
+        for (int m = s->count; m > k; m--)
+            seriesMove(s, seriesSlot(s, m), seriesSlot(s, m - 1));
+
+        int i = seriesSlot(s, k);
+        s->timeMs[i] = timeMs;
+        s->temp[i] = temp;
+        s->hum[i] = hum;
+        s->soil[i] = soil;
+        s->water[i] = water;
+        s->head = (s->head + 1) % s->cap;
+        s->count++;
+    }
+
+    int first = s->total == 0;
+    metricAdd(&s->agg[METRIC_TEMP], temp, first);
+    metricAdd(&s->agg[METRIC_HUM], hum, first);
+    metricAdd(&s->agg[METRIC_SOIL], soil, first);
+    metricAdd(&s->agg[METRIC_WATER], water, first);
+
+    float v[METRIC_COUNT] = { temp, hum, (float)soil, (float)water };
+    for (int t = 0; t < ROLLUP_TIERS; t++)
+        tierAdd(&s->tiers[t], rollupTiers[t].keep, rollupTiers[t].spanMs, timeMs, v);
+
+    if (first || timeMs < s->firstMs) s->firstMs = timeMs;
+    if (first || timeMs > s->lastMs) s->lastMs = timeMs;
+    s->total++;
+    strcpy(s->lastEvent, "DATA");
+}
+
+/* ---------- READ ----------
+ * Row k counts from the oldest reading still held (0..count-1).
+ */
+static inline void seriesRow(const Series *s, int k, SeriesRow *out) {
+    int j = seriesSlot(s, k);
+    out->timeMs = s->timeMs[j];
+    out->temp = s->temp[j];
+    out->hum = s->hum[j];
+    out->soil = s->soil[j];
+    out->water = s->water[j];
+}
+
+/* Copies the newest min(n, count) rows, oldest first. */
+static inline int seriesLatest(const Series *s, int n, SeriesRow *out) {
+    if (n > s->count) n = s->count;
+    for (int k = 0; k < n; k++)
+        seriesRow(s, s->count - n + k, &out[k]);
+    return n;
+}
+
+/* Copies rows with fromMs <= time <= toMs, up to max. The ring is in
+   time order (seriesAppend), so the scan starts at the first match
+   found by binary search. */
+static inline int seriesRange(const Series *s, int64_t fromMs, int64_t toMs,
+                              SeriesRow *out, int max) {
+    int lo = 0, hi = s->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (s->timeMs[seriesSlot(s, mid)] < fromMs) lo = mid + 1;
+        else hi = mid;
+    }
+
+    int n = 0;
+    for (int k = lo; k < s->count && n < max; k++) {
+        seriesRow(s, k, &out[n]);
+        if (out[n].timeMs > toMs) break;
+        n++;
+    }
+    return n;
+}
+
+/* ---------- ROLLUP QUERY ----------
+ * seriesPickTier() returns the index of the finest tier that still
+ * covers fromMs and answers [fromMs, toMs] in at most maxPoints
+ * buckets, falling back to the coarsest tier.
+ */
+static inline int seriesPickTier(int64_t fromMs, int64_t toMs, int64_t nowMs,
+                                 int maxPoints) {
+    for (int t = 0; t < ROLLUP_TIERS; t++) {
+        int64_t span = rollupTiers[t].spanMs;
+        int64_t oldest = nowMs - span * rollupTiers[t].keep;
+        if ((toMs - fromMs) / span + 1 <= maxPoints && fromMs >= oldest)
+            return t;
+    }
+    return ROLLUP_TIERS - 1;
+}
+
+/* Copies up to max buckets of the given tier that overlap
+   [fromMs, toMs] into out, oldest first; returns the count. */
+static inline int seriesRollup(const Series *s, int tier, int64_t fromMs,
+                               int64_t toMs, RollupBucket *out, int max) {
+    const RollupTier *t = &s->tiers[tier];
+    int64_t span = rollupTiers[tier].spanMs;
+    int n = 0;
+
+    for (int k = tierSeek(t, fromMs - span + 1); k < t->count && n < max; k++) {
+        const RollupBucket *b = tierAt(t, k);
+        if (b->startMs > toMs) break;
+        out[n++] = *b;
+    }
+    return n;
+}
+
+#endif